@@ -0,0 +1,96 @@
+#include "AsyncEventSink.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace sw
+{
+	AsyncEventSink::AsyncEventSink(std::unique_ptr<IEventSink> next, const AsyncLogOptions& options) :
+		_next(std::move(next)),
+		_options(options),
+		_ring(options.capacity),
+		_wakeMask(std::max<uint64_t>(1, _ring.capacity() / 4) - 1),
+		_writer([this] { run(); })
+	{
+	}
+
+	AsyncEventSink::~AsyncEventSink()
+	{
+		_stop.store(true);
+		wakeWriter();
+		_writer.join();
+		if (dropped())
+			std::cerr << "Event log: " << dropped() << " events dropped" << std::endl;
+	}
+
+	void AsyncEventSink::write(const EventRecord& record)
+	{
+		if (!_ring.tryPush(record))
+		{
+			wakeWriter();
+			if (_options.overflow == AsyncLogOptions::Overflow::drop)
+			{
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			do
+			{
+				std::this_thread::yield();
+				wakeWriter();
+			}
+			while (!_ring.tryPush(record));
+		}
+		++_queued;
+		//A wake-up lost to a race with the writer going to sleep only delays the records until the next one.
+		if ((record.type == EventRecord::tickSeparator || (_queued & _wakeMask) == 0) && _idle.load(std::memory_order_relaxed))
+			wakeWriter();
+	}
+
+	void AsyncEventSink::flush()
+	{
+		//Everything queued so far is popped by the pass of the writer which takes the request.
+		_flushing.store(true, std::memory_order_release);
+		while (_written.load(std::memory_order_acquire) != _queued)
+		{
+			wakeWriter();
+			std::this_thread::yield();
+		}
+	}
+
+	void AsyncEventSink::wakeWriter()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_wake.notify_one();
+	}
+
+	void AsyncEventSink::run()
+	{
+		uint64_t taken = 0;
+		EventRecord record;
+		while (true)
+		{
+			const bool stopping = _stop.load(std::memory_order_acquire);
+			const bool flushing = _flushing.exchange(false, std::memory_order_acq_rel);
+			while (_ring.tryPop(record))
+			{
+				_next->write(record);
+				++taken;
+			}
+			if (stopping || flushing)
+			{
+				_next->flush();
+				_written.store(taken, std::memory_order_release);
+			}
+			if (stopping)
+				break;
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			_idle.store(true, std::memory_order_relaxed);
+			_wake.wait(lock, [this]
+			{
+				return !_ring.empty() || _stop.load(std::memory_order_acquire) || _flushing.load(std::memory_order_acquire);
+			});
+			_idle.store(false, std::memory_order_relaxed);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "EventSink.hpp"
+#include "details/SpscRing.hpp"
+
+namespace sw
+{
+	/*! \brief Passes event records to the next sink on a background thread.
+		Records are queued by a single producer, the simulation thread, and written in the order queued.
+		Everything queued is written by flush() and by the destructor.
+		The writer sleeps until the producer wakes it: at the end of a tick, when the queue fills up and on flush.
+		The next sink is flushed on flush() and at shutdown only; it writes its destination in blocks itself.
+	*/
+	class AsyncEventSink : public IEventSink {
+	private:
+		std::unique_ptr<IEventSink> _next;
+		const AsyncLogOptions _options;
+		SpscRing<EventRecord> _ring;
+
+		//! \brief Records queued between two wake-ups of the writer within a tick.
+		const uint64_t _wakeMask;
+
+		std::atomic<bool> _stop { false };
+		std::atomic<bool> _flushing { false };
+		std::atomic<bool> _idle { false };
+		std::mutex _mutex;
+		std::condition_variable _wake;
+
+		uint64_t _queued { 0 };
+		//! \brief Records written and flushed by the next sink, published on flush.
+		std::atomic<uint64_t> _written { 0 };
+		std::atomic<uint64_t> _dropped { 0 };
+
+		std::thread _writer;
+
+		void run();
+		void wakeWriter();
+
+	public:
+		AsyncEventSink(std::unique_ptr<IEventSink> next, const AsyncLogOptions& options);
+		~AsyncEventSink() override;
+
+		AsyncEventSink(const AsyncEventSink&) = delete;
+		AsyncEventSink& operator=(const AsyncEventSink&) = delete;
+
+		//! \brief Queue the record. Producer thread only.
+		void write(const EventRecord& record) override;
+
+		//! \brief Wait until every queued record is written by the next sink. Producer thread only.
+		void flush() override;
+
+		//! \brief Records dropped because the queue was full.
+		uint64_t dropped() const
+		{
+			return _dropped.load(std::memory_order_relaxed);
+		}
+	};
+}
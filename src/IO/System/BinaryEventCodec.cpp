@@ -0,0 +1,278 @@
+#include "BinaryEventCodec.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace sw
+{
+	namespace
+	{
+		void putVarint(std::string& out, uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<char>(value));
+		}
+
+		uint64_t getVarint(std::string_view& data)
+		{
+			uint64_t value = 0;
+			for (unsigned shift = 0; shift < 64; shift += 7)
+			{
+				if (data.empty())
+					throw std::runtime_error("Binary event log: truncated varint");
+				const auto byte = static_cast<uint8_t>(data.front());
+				data.remove_prefix(1);
+				value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return value;
+			}
+			throw std::runtime_error("Binary event log: malformed varint");
+		}
+
+		void putDelta(std::string& out, int64_t delta)
+		{
+			putVarint(out, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+		}
+
+		int64_t getDelta(std::string_view& data)
+		{
+			const auto zigzag = getVarint(data);
+			return static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+		}
+
+		uint32_t applyDelta(uint32_t base, int64_t delta)
+		{
+			const auto value = static_cast<int64_t>(base) + delta;
+			if (value < 0 || value > static_cast<int64_t>(UINT32_MAX))
+				throw std::runtime_error("Binary event log: field out of range");
+			return static_cast<uint32_t>(value);
+		}
+
+		template <class TSchema, class TKind>
+		class SchemaVisitor {
+		private:
+			TSchema& _schema;
+
+		public:
+			explicit SchemaVisitor(TSchema& schema) :
+				_schema(schema)
+			{
+			}
+
+			void visit(const char* name, uint32_t)
+			{
+				const std::string_view field(name);
+				const int position = static_cast<int>(_schema.kinds.size());
+				auto kind = TKind::plain;
+				if (field == "unitId" || field == "attackerUnitId" || field == "targetUnitId")
+					kind = TKind::unitId;
+				else if (field == "x")
+					kind = TKind::x;
+				else if (field == "y")
+					kind = TKind::y;
+				else if (field == "targetX")
+					kind = TKind::targetX;
+				else if (field == "targetY")
+					kind = TKind::targetY;
+
+				if (field == "unitId")
+					_schema.unitField = position;
+				else if (kind == TKind::x)
+					_schema.xField = position;
+				else if (kind == TKind::y)
+					_schema.yField = position;
+				_schema.kinds.push_back(kind);
+			}
+
+			void visit(const char*, const std::string&)
+			{
+				_schema.kinds.push_back(TKind::text);
+			}
+		};
+	}
+
+	const BinaryEventCodec::Schema& BinaryEventCodec::schemaOf(uint8_t type)
+	{
+		static const auto schemas = []
+		{
+			std::array<Schema, EventTypes::size> result;
+			for (uint8_t tag = 0; tag < EventTypes::size; ++tag)
+			{
+				EventTypes::dispatch(
+					tag,
+					[&result, tag](auto event)
+					{
+						SchemaVisitor<Schema, FieldKind> visitor(result[tag]);
+						event.visit(visitor);
+					});
+			}
+			return result;
+		}();
+		if (type >= schemas.size())
+			throw std::runtime_error("Binary event log: unknown event type");
+		return schemas[type];
+	}
+
+	uint32_t BinaryEventCodec::base(const Schema& schema, const RecordFields& fields, size_t field)
+	{
+		const auto cellOfUnit = [&]() -> UnitCell
+		{
+			if (schema.unitField < 0 || static_cast<size_t>(schema.unitField) >= field)
+				return {};
+			const auto found = _cells.find(fields.values[schema.unitField]);
+			return found == _cells.end() ? UnitCell {} : found->second;
+		};
+		switch (schema.kinds[field])
+		{
+		case FieldKind::unitId:
+			return _lastId;
+		case FieldKind::x:
+			return cellOfUnit().x;
+		case FieldKind::y:
+			return cellOfUnit().y;
+		case FieldKind::targetX:
+			return schema.xField >= 0 && static_cast<size_t>(schema.xField) < field ? fields.values[schema.xField] : 0;
+		case FieldKind::targetY:
+			return schema.yField >= 0 && static_cast<size_t>(schema.yField) < field ? fields.values[schema.yField] : 0;
+		case FieldKind::plain:
+		case FieldKind::text:
+			break;
+		}
+		return 0;
+	}
+
+	void BinaryEventCodec::track(const Schema& schema, const RecordFields& fields)
+	{
+		if (schema.unitField >= 0 && schema.xField >= 0 && schema.yField >= 0)
+			_cells[fields.values[schema.unitField]] = { fields.values[schema.xField], fields.values[schema.yField] };
+	}
+
+	void BinaryEventEncoder::header(std::string& out)
+	{
+		out.append(magic, sizeof(magic));
+		out.push_back(static_cast<char>(version));
+	}
+
+	void BinaryEventEncoder::encode(std::string& out, const EventRecord& record)
+	{
+		if (record.tick != _tick)
+		{
+			out.push_back(static_cast<char>(tickTag));
+			putDelta(out, static_cast<int64_t>(record.tick - _tick));
+			_tick = record.tick;
+		}
+		if (record.type == EventRecord::tickSeparator)
+		{
+			out.push_back(static_cast<char>(separatorTag));
+			return;
+		}
+		const auto& schema = schemaOf(record.type);
+		if (schema.kinds.size() != record.fields.count)
+			throw std::logic_error("Binary event log: record does not match its event type");
+		out.push_back(static_cast<char>(record.type));
+		for (size_t field = 0; field < schema.kinds.size(); ++field)
+		{
+			const auto value = record.fields.values[field];
+			switch (schema.kinds[field])
+			{
+			case FieldKind::plain:
+				putVarint(out, value);
+				break;
+			case FieldKind::text:
+			{
+				auto [it, inserted] = _strings.emplace(value, static_cast<uint32_t>(_strings.size()));
+				putVarint(out, it->second);
+				if (inserted)
+				{
+					const auto& text = internedString(value);
+					putVarint(out, text.size());
+					out.append(text);
+				}
+				break;
+			}
+			default:
+				putDelta(out, static_cast<int64_t>(value) - base(schema, record.fields, field));
+				break;
+			}
+			if (schema.kinds[field] == FieldKind::unitId)
+				_lastId = value;
+		}
+		track(schema, record.fields);
+	}
+
+	void BinaryEventDecoder::header(std::string_view& data)
+	{
+		if (data.size() < headerSize || std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+			throw std::runtime_error("Binary event log: bad header");
+		if (static_cast<uint8_t>(data[sizeof(magic)]) != version)
+			throw std::runtime_error("Binary event log: unsupported version");
+		data.remove_prefix(headerSize);
+	}
+
+	bool BinaryEventDecoder::decode(std::string_view& data, EventRecord& record)
+	{
+		while (!data.empty() && static_cast<uint8_t>(data.front()) == tickTag)
+		{
+			data.remove_prefix(1);
+			_tick += static_cast<uint64_t>(getDelta(data));
+		}
+		if (data.empty())
+			return false;
+
+		const auto tag = static_cast<uint8_t>(data.front());
+		data.remove_prefix(1);
+		record = EventRecord {};
+		record.tick = _tick;
+		if (tag == separatorTag)
+		{
+			record.type = EventRecord::tickSeparator;
+			return true;
+		}
+		const auto& schema = schemaOf(tag);
+		record.type = tag;
+		record.fields.count = static_cast<uint8_t>(schema.kinds.size());
+		for (size_t field = 0; field < schema.kinds.size(); ++field)
+		{
+			auto& value = record.fields.values[field];
+			switch (schema.kinds[field])
+			{
+			case FieldKind::plain:
+			{
+				const auto raw = getVarint(data);
+				if (raw > UINT32_MAX)
+					throw std::runtime_error("Binary event log: field out of range");
+				value = static_cast<uint32_t>(raw);
+				break;
+			}
+			case FieldKind::text:
+			{
+				const auto index = getVarint(data);
+				if (index == _strings.size())
+				{
+					const auto length = getVarint(data);
+					if (length > data.size())
+						throw std::runtime_error("Binary event log: truncated string");
+					_strings.push_back(internString(std::string(data.substr(0, length))));
+					data.remove_prefix(length);
+				}
+				if (index >= _strings.size())
+					throw std::runtime_error("Binary event log: unknown string");
+				value = _strings[index];
+				break;
+			}
+			default:
+				value = applyDelta(base(schema, record.fields, field), getDelta(data));
+				break;
+			}
+			if (schema.kinds[field] == FieldKind::unitId)
+				_lastId = value;
+		}
+		track(schema, record.fields);
+		return true;
+	}
+}
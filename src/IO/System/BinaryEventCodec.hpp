@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "EventRecord.hpp"
+
+namespace sw
+{
+	/*
+		Binary event log.
+
+		The stream starts with the magic "SWEV" and a version byte, then items follow, each starting with a tag byte:
+			0 .. EventTypes::size-1 - event of that type, its fields follow;
+			separatorTag            - blank line ending a tick;
+			tickTag                 - the tick changes: varint of the difference with the previous tick.
+		The tick is written once per group of events, not per event.
+
+		Fields are encoded by what the event's visit() calls them:
+			unit ids (unitId, attackerUnitId, targetUnitId) - zigzag varint of the difference with the previous id;
+			x, y                                            - zigzag varint of the difference with the last cell of the unit;
+			targetX, targetY                                - zigzag varint of the difference with x, y of the event;
+			strings                                         - varint index in the string table of the stream;
+			                                                  a new string is followed by its length and bytes;
+			anything else                                   - varint.
+	*/
+	class BinaryEventCodec {
+	public:
+		static constexpr char magic[4] = { 'S', 'W', 'E', 'V' };
+		static constexpr uint8_t version = 1;
+		static constexpr uint8_t separatorTag = 0xFD;
+		static constexpr uint8_t tickTag = 0xFE;
+		static constexpr size_t headerSize = sizeof(magic) + 1;
+
+	protected:
+		enum class FieldKind : uint8_t
+		{
+			plain,
+			unitId,
+			x,
+			y,
+			targetX,
+			targetY,
+			text
+		};
+
+		struct Schema
+		{
+			std::vector<FieldKind> kinds;
+			//! \brief Position of the field "unitId", the unit whose cell x and y are relative to.
+			int unitField = -1;
+			int xField = -1;
+			int yField = -1;
+		};
+
+		struct UnitCell
+		{
+			uint32_t x {};
+			uint32_t y {};
+		};
+
+		static const Schema& schemaOf(uint8_t type);
+
+		uint64_t _tick {};
+		uint32_t _lastId {};
+		std::unordered_map<uint32_t, UnitCell> _cells;
+
+		//! \brief Remember the cell of the unit of the record.
+		void track(const Schema& schema, const RecordFields& fields);
+		uint32_t base(const Schema& schema, const RecordFields& fields, size_t field);
+	};
+
+	class BinaryEventEncoder : public BinaryEventCodec {
+	private:
+		//! \brief Index in the stream's string table by the index in the process string pool.
+		std::unordered_map<uint32_t, uint32_t> _strings;
+
+	public:
+		//! \brief Append the stream header.
+		static void header(std::string& out);
+
+		//! \brief Append the record.
+		void encode(std::string& out, const EventRecord& record);
+	};
+
+	class BinaryEventDecoder : public BinaryEventCodec {
+	private:
+		//! \brief Index in the process string pool by the index in the stream's string table.
+		std::vector<uint32_t> _strings;
+
+	public:
+		/*! \brief Check and skip the stream header.
+			\exception std::runtime_error if the data is not a binary event log.
+		*/
+		static void header(std::string_view& data);
+
+		/*! \brief Decode the next record and remove its bytes from `data`.
+			\return false if there is no more records.
+			\exception std::runtime_error if the data is malformed.
+		*/
+		bool decode(std::string_view& data, EventRecord& record);
+	};
+}
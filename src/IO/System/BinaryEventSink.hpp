@@ -0,0 +1,49 @@
+#pragma once
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include "BinaryEventCodec.hpp"
+#include "EventSink.hpp"
+
+namespace sw
+{
+	//! \brief Encodes event records into a binary event log file, writing it in large blocks.
+	class BinaryEventSink : public IEventSink {
+	private:
+		static constexpr size_t blockSize = 1 << 16;
+
+		std::ofstream _file;
+		std::string _block;
+		BinaryEventEncoder _encoder;
+
+	public:
+		explicit BinaryEventSink(const std::string& filename) :
+			_file(filename, std::ios::binary | std::ios::trunc)
+		{
+			if (!_file)
+				throw std::runtime_error("Cannot open binary event log: " + filename);
+			_block.reserve(blockSize + 256);
+			BinaryEventEncoder::header(_block);
+		}
+
+		~BinaryEventSink() override
+		{
+			flush();
+		}
+
+		void write(const EventRecord& record) override
+		{
+			_encoder.encode(_block, record);
+			if (_block.size() >= blockSize)
+				flush();
+		}
+
+		void flush() override
+		{
+			_file.write(_block.data(), static_cast<std::streamsize>(_block.size()));
+			_file.flush();
+			_block.clear();
+		}
+	};
+}
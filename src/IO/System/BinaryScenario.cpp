@@ -0,0 +1,62 @@
+#include "BinaryScenario.hpp"
+
+namespace sw::io
+{
+	void BinaryScenarioWriter::add(const CreateMap& command)
+	{
+		if (_created)
+			throw std::runtime_error("Already created");
+		if (!command.width || !command.height)
+			throw std::runtime_error("Incorrect width or height");
+		_map = command;
+		_created = true;
+	}
+
+	void BinaryScenarioWriter::addUnit(uint32_t unitId, uint32_t x, uint32_t y)
+	{
+		if (!_created)
+			throw std::runtime_error("Battle field has not been created");
+		if (x >= _map.width)
+			throw std::runtime_error("X coordinate: out of range");
+		if (y >= _map.height)
+			throw std::runtime_error("Y coordinate: out of range");
+		if (!_cells.insert((static_cast<uint64_t>(x) << 32) | y).second)
+			throw std::runtime_error("Could not place unit into the cell specified");
+		if (!_ids.insert(unitId).second)
+			throw std::runtime_error("Unit already created");
+		++_units;
+	}
+
+	void BinaryScenarioWriter::add(const SpawnWarrior& command)
+	{
+		addUnit(command.unitId, command.x, command.y);
+		writeRecord(_records, command);
+	}
+
+	void BinaryScenarioWriter::add(const SpawnArcher& command)
+	{
+		addUnit(command.unitId, command.x, command.y);
+		writeRecord(_records, command);
+	}
+
+	void BinaryScenarioWriter::add(const March& command)
+	{
+		if (!_created)
+			throw std::runtime_error("Battle field has not been created");
+		if (!_ids.count(command.unitId))
+			throw std::runtime_error("Unit not found");
+		++_marches;
+		writeRecord(_records, command);
+	}
+
+	std::string BinaryScenarioWriter::finish() const
+	{
+		if (!_created)
+			throw std::runtime_error("Battle field has not been created");
+		std::string out;
+		out.reserve(headerSize + _records.size());
+		writeHeader(out, _map, _units, _marches);
+		out.append(_records);
+		return out;
+	}
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <IO/Commands/CreateMap.hpp>
+#include <IO/Commands/SpawnWarrior.hpp>
+#include <IO/Commands/SpawnArcher.hpp>
+#include <IO/Commands/March.hpp>
+
+namespace sw::io
+{
+	/*
+		Binary scenario: a command file compiled ahead of time.
+
+		Header, fields are little-endian:
+			magic "SWSC", version    - 4 bytes + uint32;
+			width, height            - the map, i.e. the only CREATE_MAP command;
+			units, marches           - uint32 counts of the records of each sort.
+		Then records in the order of the command file: the tag of the command (its index in ScenarioCommands),
+		then every field of the command as uint32, in the order of its visit().
+
+		The compiler checks what the simulation would reject while creating the battle: the map is created once and first,
+		units are inside the map, in free cells and have unique ids, marches refer to units spawned before them.
+		Loading saves the parsing of text only: the battle checks the records as it applies them,
+		so a damaged scenario fails with the same errors as a bad command file.
+	*/
+	template <class... TCommands>
+	struct CommandList
+	{
+		static constexpr uint8_t size = sizeof...(TCommands);
+
+		//! \brief Tag of the command type: its index in the list.
+		template <class TCommand>
+		static constexpr uint8_t tagOf()
+		{
+			uint8_t tag = 0;
+			bool found = ((std::is_same_v<std::decay_t<TCommand>, TCommands> ? true : (++tag, false)) || ...);
+			return found ? tag : size;
+		}
+
+		//! \brief Call `visitor` with a default constructed command of the type tagged.
+		template <class TVisitor>
+		static bool dispatch(uint8_t tag, TVisitor&& visitor)
+		{
+			uint8_t index = 0;
+			return ((index++ == tag ? (visitor(TCommands{}), true) : false) || ...);
+		}
+	};
+
+	//! \brief Commands stored as records of a binary scenario.
+	using ScenarioCommands = CommandList<SpawnWarrior, SpawnArcher, March>;
+
+	class BinaryScenario {
+	public:
+		static constexpr char magic[4] = { 'S', 'W', 'S', 'C' };
+		static constexpr uint32_t version = 1;
+		static constexpr size_t headerSize = sizeof(magic) + 5 * sizeof(uint32_t);
+
+		//! \brief Check if the data starts as a binary scenario.
+		static bool isBinary(std::string_view data)
+		{
+			return data.size() >= sizeof(magic) && std::memcmp(data.data(), magic, sizeof(magic)) == 0;
+		}
+
+		/*! \brief Number of units the scenario spawns, from its header.
+			\exception std::runtime_error if the data is not a binary scenario.
+		*/
+		static uint32_t unitCount(std::string_view data)
+		{
+			if (data.size() < headerSize || !isBinary(data))
+				throw std::runtime_error("Binary scenario: bad header");
+			data.remove_prefix(sizeof(magic) + 3 * sizeof(uint32_t));
+			return getUint32(data);
+		}
+
+		/*! \brief Call `handler` with every command of the scenario, CREATE_MAP first.
+			\exception std::runtime_error if the data is not a binary scenario or is malformed.
+		*/
+		template <class THandler>
+		static void read(std::string_view data, THandler&& handler)
+		{
+			if (data.size() < headerSize || !isBinary(data))
+				throw std::runtime_error("Binary scenario: bad header");
+			data.remove_prefix(sizeof(magic));
+			if (getUint32(data) != version)
+				throw std::runtime_error("Binary scenario: unsupported version");
+			CreateMap map;
+			map.width = getUint32(data);
+			map.height = getUint32(data);
+			getUint32(data);
+			getUint32(data);
+			handler(map);
+
+			while (!data.empty())
+			{
+				const auto tag = static_cast<uint8_t>(data.front());
+				data.remove_prefix(1);
+				const bool known = ScenarioCommands::dispatch(
+					tag,
+					[&data, &handler](auto command)
+					{
+						ReadFieldVisitor visitor(data);
+						command.visit(visitor);
+						handler(command);
+					});
+				if (!known)
+					throw std::runtime_error("Binary scenario: unknown command");
+			}
+		}
+
+		//! \brief Append the header. Records follow it.
+		static void writeHeader(std::string& out, const CreateMap& map, uint32_t units, uint32_t marches)
+		{
+			out.append(magic, sizeof(magic));
+			putUint32(out, version);
+			putUint32(out, map.width);
+			putUint32(out, map.height);
+			putUint32(out, units);
+			putUint32(out, marches);
+		}
+
+		//! \brief Append the record of the command, unchecked. See BinaryScenarioWriter for a checked scenario.
+		template <class TCommand>
+		static void writeRecord(std::string& out, TCommand command)
+		{
+			constexpr auto tag = ScenarioCommands::tagOf<TCommand>();
+			static_assert(tag < ScenarioCommands::size, "Command is not registered in ScenarioCommands");
+			out.push_back(static_cast<char>(tag));
+			WriteFieldVisitor visitor(out);
+			command.visit(visitor);
+		}
+
+	protected:
+		static void putUint32(std::string& out, uint32_t value)
+		{
+			const char bytes[4] = {
+				static_cast<char>(value), static_cast<char>(value >> 8),
+				static_cast<char>(value >> 16), static_cast<char>(value >> 24) };
+			out.append(bytes, sizeof(bytes));
+		}
+
+		static uint32_t getUint32(std::string_view& data)
+		{
+			if (data.size() < 4)
+				throw std::runtime_error("Binary scenario: truncated record");
+			const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+			data.remove_prefix(4);
+			return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+		}
+
+		class ReadFieldVisitor {
+		private:
+			std::string_view& _data;
+
+		public:
+			explicit ReadFieldVisitor(std::string_view& data) :
+				_data(data)
+			{
+			}
+
+			void visit(const char*, uint32_t& value)
+			{
+				value = getUint32(_data);
+			}
+		};
+
+		class WriteFieldVisitor {
+		private:
+			std::string& _out;
+
+		public:
+			explicit WriteFieldVisitor(std::string& out) :
+				_out(out)
+			{
+			}
+
+			void visit(const char*, uint32_t value)
+			{
+				putUint32(_out, value);
+			}
+		};
+	};
+
+	//! \brief Compiles commands into a binary scenario, checking them as it goes.
+	class BinaryScenarioWriter : public BinaryScenario {
+	private:
+		std::string _records;
+		CreateMap _map;
+		bool _created {};
+		uint32_t _units {};
+		uint32_t _marches {};
+		std::unordered_set<uint32_t> _ids;
+		std::unordered_set<uint64_t> _cells;
+
+		void addUnit(uint32_t unitId, uint32_t x, uint32_t y);
+
+	public:
+		/*! \brief Add the command.
+			\exception std::runtime_error with the message the simulation would fail with.
+		*/
+		void add(const CreateMap& command);
+		void add(const SpawnWarrior& command);
+		void add(const SpawnArcher& command);
+		void add(const March& command);
+
+		/*! \brief Get the compiled scenario.
+			\exception std::runtime_error if the map has not been created.
+		*/
+		std::string finish() const;
+	};
+
+	//! \brief Prints commands in the text format of command files.
+	class CommandPrintVisitor {
+	private:
+		std::string& _out;
+
+	public:
+		explicit CommandPrintVisitor(std::string& out) :
+			_out(out)
+		{
+		}
+
+		void visit(const char*, uint32_t value)
+		{
+			_out.append(1, ' ').append(std::to_string(value));
+		}
+	};
+}
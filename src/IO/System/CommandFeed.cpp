@@ -0,0 +1,57 @@
+#include "CommandFeed.hpp"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace sw::io
+{
+	CommandFeed::CommandFeed(std::istream& stream, CommandParser& parser) :
+		_stream(stream),
+		_parser(parser)
+	{
+	}
+
+	bool CommandFeed::splitStamp(std::string& line, uint64_t& tick)
+	{
+		const auto begin = line.find_first_not_of(" \t");
+		if (begin == std::string::npos || line[begin] != '@')
+			return false;
+		const char* digits = line.data() + begin + 1;
+		const char* end = line.data() + line.size();
+		const auto [stampEnd, error] = std::from_chars(digits, end, tick);
+		if (error != std::errc() || (stampEnd != end && stampEnd[0] != ' ' && stampEnd[0] != '\t' && stampEnd[0] != '\r'))
+			throw std::runtime_error("Malformed tick stamp: " + line);
+		line.erase(0, static_cast<size_t>(stampEnd - line.data()));
+		return true;
+	}
+
+	void CommandFeed::applyUntil(uint64_t tick)
+	{
+		while (true)
+		{
+			if (_ahead)
+			{
+				if (_aheadTick > tick)
+					return;
+				_ahead = false;
+				_parser.parseLine(_line);
+				continue;
+			}
+			if (_ended)
+				return;
+			if (!std::getline(_stream, _line))
+			{
+				_ended = true;
+				return;
+			}
+			uint64_t stamp = 0;
+			if (splitStamp(_line, stamp) && stamp > tick)
+			{
+				_aheadTick = stamp;
+				_ahead = true;
+				return;
+			}
+			_parser.parseLine(_line);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include "CommandParser.hpp"
+
+namespace sw::io
+{
+	/*! \brief Reads commands from a stream as the simulation goes, e.g. from stdin fed by a generator.
+		A line may be stamped with the tick it is applied at: `@120 MARCH 3 0 0`. A bare stamp `@120` carries no command
+		and only tells that nothing comes before tick 120. Lines without a stamp, and lines stamped with a tick already
+		passed, are applied at the tick being reached when they are read. Stamps are expected not to decrease.
+		Only one line is held ahead, so memory does not grow with the length of the stream.
+	*/
+	class CommandFeed {
+	private:
+		std::istream& _stream;
+		CommandParser& _parser;
+		std::string _line;
+		//! \brief Tick of the line read ahead, kept in _line.
+		uint64_t _aheadTick {};
+		bool _ahead {};
+		bool _ended {};
+
+		/*! \brief Split the stamp off the line.
+			\return true if the line is stamped.
+			\exception std::runtime_error if the stamp is malformed.
+		*/
+		static bool splitStamp(std::string& line, uint64_t& tick);
+
+	public:
+		CommandFeed(std::istream& stream, CommandParser& parser);
+
+		/*! \brief Apply the commands up to `tick`: reads the stream until a line stamped with a later tick or its end.
+			\exception std::runtime_error if a command or a stamp is malformed.
+		*/
+		void applyUntil(uint64_t tick);
+
+		//! \brief Check if every command of the stream has been applied.
+		bool exhausted() const
+		{
+			return _ended && !_ahead;
+		}
+	};
+}
@@ -1,26 +1,55 @@
 #include "CommandParser.hpp"
 
+#include <iterator>
+
 namespace sw::io
 {
-	void CommandParser::parse(std::istream& stream)
+	namespace
 	{
-		std::string line;
-		while (std::getline(stream, line)) {
-			if (line.rfind("//", 0) == 0 || line.empty())
-				continue;
+		bool isSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+		}
+	}
 
-			std::istringstream commandStream(line);
-			std::string commandName;
-			commandStream >> commandName;
+	bool CommandParser::splitLine(std::string_view line, std::string_view& name, std::string_view& fields)
+	{
+		if (line.rfind("//", 0) == 0 || line.empty())
+			return false;
 
-			if (commandName.empty())
-				continue;
+		size_t nameBegin = 0;
+		while (nameBegin < line.size() && isSpace(line[nameBegin]))
+			++nameBegin;
+		size_t nameEnd = nameBegin;
+		while (nameEnd < line.size() && !isSpace(line[nameEnd]))
+			++nameEnd;
+		name = line.substr(nameBegin, nameEnd - nameBegin);
+		fields = line.substr(nameEnd);
+		return !name.empty();
+	}
 
-			auto command = commands_.find(commandName);
-			if (command == commands_.end())
-				throw std::runtime_error("Unknown command: " + commandName);
+	void CommandParser::parseLine(std::string_view line)
+	{
+		std::string_view commandName;
+		std::string_view fields;
+		if (!splitLine(line, commandName, fields))
+			return;
 
-			command->second(commandStream);
-		}
+		auto command = commands_.find(commandName);
+		if (command == commands_.end())
+			throw std::runtime_error("Unknown command: " + std::string(commandName));
+
+		command->second(fields);
+	}
+
+	void CommandParser::parse(std::string_view text)
+	{
+		forEachLine(text, [this](std::string_view line) { parseLine(line); });
+	}
+
+	void CommandParser::parse(std::istream& stream)
+	{
+		const std::string text(std::istreambuf_iterator<char>(stream), {});
+		parse(std::string_view(text));
 	}
-}
\ No newline at end of file
+}
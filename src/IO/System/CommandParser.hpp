@@ -1,8 +1,10 @@
 #pragma once
 
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <istream>
 #include <functional>
+#include <unordered_map>
 #include "details/CommandParserVisitor.hpp"
 #include "actors.h"
 
@@ -10,7 +12,18 @@ namespace sw::io
 {
 	class CommandParser {
 	private:
-		std::unordered_map<std::string, std::function<void(std::istream&)>> commands_;
+		//! \brief Looks commands up by a view of the line, without building a string.
+		struct NameHash
+		{
+			using is_transparent = void;
+
+			size_t operator()(std::string_view name) const
+			{
+				return std::hash<std::string_view>()(name);
+			}
+		};
+
+		std::unordered_map<std::string, std::function<void(std::string_view)>, NameHash, std::equal_to<>> commands_;
 
 	public:
 		template <class TCommandData>
@@ -19,10 +32,10 @@ namespace sw::io
 			std::string commandName = TCommandData::Name;
 			auto [it, inserted] = commands_.emplace(
 										commandName,
-										[handler = std::move(handler)](std::istream& stream)
+										[handler = std::move(handler)](std::string_view fields)
 										{
 											TCommandData data;
-											CommandParserVisitor visitor(stream);
+											CommandParserVisitor visitor(fields);
 											data.visit(visitor);
 											handler(std::move(data));
 										});
@@ -31,6 +44,32 @@ namespace sw::io
 			}
 			return *this;
 		}
+
+		/*! \brief Split a line without its end of line into the name of its command and the fields after it.
+			\return false if the line holds no command: it is empty, blank or a comment.
+		*/
+		static bool splitLine(std::string_view line, std::string_view& name, std::string_view& fields);
+
+		//! \brief Call `visitor(std::string_view line)` with every line of the text, without its end of line.
+		template <class TVisitor>
+		static void forEachLine(std::string_view text, TVisitor&& visitor)
+		{
+			while (!text.empty()) {
+				const auto lineEnd = text.find('\n');
+				visitor(text.substr(0, lineEnd));
+				text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+			}
+		}
+
+		/*! \brief Parse one line without its end of line. Empty lines and lines starting with // are skipped.
+			\exception std::runtime_error if the command is unknown.
+		*/
+		void parseLine(std::string_view line);
+
+		//! \brief Parse the whole text of a command file, e.g. a MappedFile.
+		void parse(std::string_view text);
+
+		//! \brief Read the stream to its end and parse it.
 		void parse(std::istream& stream);
 	};
-}
\ No newline at end of file
+}
@@ -1,20 +1,60 @@
 #pragma once
 
 #include <iostream>
-#include <typeindex>
-#include <unordered_map>
+#include <memory>
+#include "EventSink.hpp"
+
+#ifndef SW_EVENT_LOG
+#define SW_EVENT_LOG 1
+#endif
 
 namespace sw
 {
 	class EventLog {
+	private:
+		std::unique_ptr<IEventSink> _sink = std::make_unique<TextEventSink>(std::cout);
+		//! \brief Text sink of a chain which is nothing else: events are printed without packing them into records.
+		TextEventSink* _text = _sink->textSink();
+
 	public:
 		template <class TEvent>
 		void log(uint64_t tick, TEvent&& event)
 		{
-			std::cout << "[" << tick << "] " << TEvent::Name << " ";
-			PrintFieldVisitor visitor(std::cout);
-			event.visit(visitor);
-			std::cout << std::endl;
+			if constexpr (SW_EVENT_LOG)
+			{
+				if (_text)
+					_text->print(tick, event);
+				else if (_sink)
+					_sink->write(makeRecord(tick, event));
+			}
+		}
+
+		//! \brief Log the end of the tick.
+		void endTick(uint64_t tick)
+		{
+			if constexpr (SW_EVENT_LOG)
+			{
+				if (_text)
+					_text->endTick();
+				else if (_sink)
+					_sink->write(makeSeparatorRecord(tick));
+			}
+		}
+
+		//! \brief Send events to the sink from now on. nullptr drops them.
+		void setSink(std::unique_ptr<IEventSink> sink)
+		{
+			if (_sink)
+				_sink->flush();
+			_sink = std::move(sink);
+			_text = _sink ? _sink->textSink() : nullptr;
+		}
+
+		//! \brief Wait until all events logged are written.
+		void flush()
+		{
+			if (_sink)
+				_sink->flush();
 		}
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,72 @@
+#include "EventRecord.hpp"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace sw
+{
+	namespace
+	{
+		class StringPool {
+		private:
+			std::mutex _mutex;
+			std::deque<std::string> _strings;
+			std::unordered_map<std::string, uint32_t> _indexes;
+
+		public:
+			uint32_t intern(const std::string& value)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				auto [it, inserted] = _indexes.emplace(value, static_cast<uint32_t>(_strings.size()));
+				if (inserted)
+					_strings.push_back(value);
+				return it->second;
+			}
+
+			const std::string& get(uint32_t index)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (index >= _strings.size())
+					throw std::logic_error("Unknown interned string");
+				return _strings[index];
+			}
+		};
+
+		StringPool& stringPool()
+		{
+			//Never destroyed: writer threads may still format records while static objects are destroyed.
+			static StringPool* pool = new StringPool;
+			return *pool;
+		}
+	}
+
+	uint32_t internString(const std::string& value)
+	{
+		return stringPool().intern(value);
+	}
+
+	const std::string& internedString(uint32_t index)
+	{
+		return stringPool().get(index);
+	}
+
+	void formatRecord(std::string& out, const EventRecord& record)
+	{
+		if (record.type == EventRecord::tickSeparator)
+		{
+			out.push_back('\n');
+			return;
+		}
+		const bool known = EventTypes::dispatch(
+			record.type,
+			[&out, &record](auto event)
+			{
+				UnpackFieldVisitor unpack(record.fields);
+				event.visit(unpack);
+				formatEvent(out, record.tick, event);
+			});
+		if (!known)
+			throw std::logic_error("Unknown event type in record");
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <IO/Events/MapCreated.hpp>
+#include <IO/Events/UnitSpawned.hpp>
+#include <IO/Events/MarchStarted.hpp>
+#include <IO/Events/MarchEnded.hpp>
+#include <IO/Events/UnitMoved.hpp>
+#include <IO/Events/UnitDied.hpp>
+#include <IO/Events/UnitAttacked.hpp>
+#include "details/RecordFieldVisitor.hpp"
+
+namespace sw
+{
+	template <class... TEvents>
+	struct EventList
+	{
+		static constexpr uint8_t size = sizeof...(TEvents);
+
+		//! \brief Tag of the event type: its index in the list.
+		template <class TEvent>
+		static constexpr uint8_t tagOf()
+		{
+			uint8_t tag = 0;
+			bool found = ((std::is_same_v<std::decay_t<TEvent>, TEvents> ? true : (++tag, false)) || ...);
+			return found ? tag : size;
+		}
+
+		//! \brief Call `visitor` with a default constructed event of the type tagged.
+		template <class TVisitor>
+		static bool dispatch(uint8_t tag, TVisitor&& visitor)
+		{
+			uint8_t index = 0;
+			return ((index++ == tag ? (visitor(TEvents{}), true) : false) || ...);
+		}
+	};
+
+	//! \brief Every event the simulation logs.
+	using EventTypes = EventList<
+		io::MapCreated,
+		io::UnitSpawned,
+		io::MarchStarted,
+		io::MarchEnded,
+		io::UnitMoved,
+		io::UnitDied,
+		io::UnitAttacked>;
+
+	//! \brief Compact form of a logged event: fixed size, no heap memory.
+	struct EventRecord
+	{
+		//! \brief Tag of the blank line separating ticks.
+		static constexpr uint8_t tickSeparator = EventTypes::size;
+		static constexpr uint8_t maxFields = RecordFields::capacity;
+
+		uint64_t tick {};
+		uint8_t type {};
+		RecordFields fields {};
+	};
+
+	template <class TEvent>
+	EventRecord makeRecord(uint64_t tick, TEvent& event)
+	{
+		constexpr auto tag = EventTypes::tagOf<TEvent>();
+		static_assert(tag < EventTypes::size, "Event is not registered in EventTypes");
+		EventRecord record;
+		record.tick = tick;
+		record.type = tag;
+		PackFieldVisitor visitor(record.fields);
+		event.visit(visitor);
+		return record;
+	}
+
+	inline EventRecord makeSeparatorRecord(uint64_t tick)
+	{
+		EventRecord record;
+		record.tick = tick;
+		record.type = EventRecord::tickSeparator;
+		return record;
+	}
+
+	//! \brief Append the text EventLog prints for the event, new line included.
+	template <class TEvent>
+	void formatEvent(std::string& out, uint64_t tick, TEvent& event)
+	{
+		char digits[24];
+		const auto result = std::to_chars(digits, digits + sizeof(digits), tick);
+		out.append(1, '[').append(digits, result.ptr).append("] ").append(TEvent::Name).append(1, ' ');
+		AppendFieldVisitor visitor(out);
+		event.visit(visitor);
+		out.push_back('\n');
+	}
+
+	//! \brief Append the text EventLog prints for the record, new line included.
+	void formatRecord(std::string& out, const EventRecord& record);
+}
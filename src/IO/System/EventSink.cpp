@@ -0,0 +1,119 @@
+#include "EventSink.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include "AsyncEventSink.hpp"
+#include "BinaryEventSink.hpp"
+#include <string_view>
+
+namespace sw
+{
+	TextEventSink::TextEventSink(std::ostream& stream) :
+		_stream(stream)
+	{
+		_block.reserve(blockSize + 256);
+	}
+
+	TextEventSink::~TextEventSink()
+	{
+		flush();
+	}
+
+	void TextEventSink::write(const EventRecord& record)
+	{
+		formatRecord(_block, record);
+		flushIfFull();
+	}
+
+	void TextEventSink::flush()
+	{
+		_stream.write(_block.data(), static_cast<std::streamsize>(_block.size()));
+		_stream.flush();
+		_block.clear();
+	}
+
+	TextFileEventSink::TextFileEventSink(const std::string& filename) :
+		_file(filename, std::ios::binary | std::ios::trunc),
+		_text(_file)
+	{
+		if (!_file)
+			throw std::runtime_error("Cannot open event log: " + filename);
+	}
+
+	void TextFileEventSink::write(const EventRecord& record)
+	{
+		_text.write(record);
+	}
+
+	void TextFileEventSink::flush()
+	{
+		_text.flush();
+	}
+
+	FilterEventSink::FilterEventSink(std::unique_ptr<IEventSink> next, uint64_t acceptedTypes) :
+		_next(std::move(next)),
+		_accepted(acceptedTypes)
+	{
+	}
+
+	void FilterEventSink::write(const EventRecord& record)
+	{
+		if (record.type == EventRecord::tickSeparator || (_accepted >> record.type) & 1)
+			_next->write(record);
+	}
+
+	void FilterEventSink::flush()
+	{
+		_next->flush();
+	}
+
+	uint64_t FilterEventSink::typesMask(const std::vector<std::string>& names)
+	{
+		static_assert(EventTypes::size <= 64, "Event type mask is too narrow");
+		uint64_t mask = 0;
+		for (const auto& name : names)
+		{
+			bool known = false;
+			for (uint8_t tag = 0; tag < EventTypes::size; ++tag)
+			{
+				EventTypes::dispatch(
+					tag,
+					[&](auto event)
+					{
+						if (name == std::string_view(event.Name))
+						{
+							mask |= uint64_t(1) << tag;
+							known = true;
+						}
+					});
+			}
+			if (!known)
+				throw std::runtime_error("Unknown event: " + name);
+		}
+		return mask;
+	}
+
+	std::unique_ptr<IEventSink> createEventSink(const EventSinkOptions& options)
+	{
+		std::unique_ptr<IEventSink> sink;
+		switch (options.target)
+		{
+		case EventSinkOptions::Target::none:
+			return nullptr;
+		case EventSinkOptions::Target::standardOutput:
+			sink = std::make_unique<TextEventSink>(std::cout);
+			break;
+		case EventSinkOptions::Target::textFile:
+			sink = std::make_unique<TextFileEventSink>(options.path);
+			break;
+		case EventSinkOptions::Target::binaryFile:
+			sink = std::make_unique<BinaryEventSink>(options.path);
+			break;
+		}
+		if (options.async)
+			sink = std::make_unique<AsyncEventSink>(std::move(sink), options.asyncOptions);
+		if (!options.events.empty())
+			sink = std::make_unique<FilterEventSink>(std::move(sink), FilterEventSink::typesMask(options.events));
+		return sink;
+	}
+}
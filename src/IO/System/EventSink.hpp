@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "EventRecord.hpp"
+
+namespace sw
+{
+	class TextEventSink;
+
+	//! \brief Destination of logged events, chosen at startup.
+	class IEventSink {
+	public:
+		virtual ~IEventSink() = default;
+
+		//! \brief Take the record: an event or the end of a tick.
+		virtual void write(const EventRecord& record) = 0;
+
+		//! \brief Push everything taken so far to its destination.
+		virtual void flush() = 0;
+
+		//! \brief Sink printing events as they are logged, without packing them into records. nullptr if the chain has none.
+		virtual TextEventSink* textSink()
+		{
+			return nullptr;
+		}
+	};
+
+	//! \brief Prints events as text, writing the stream in blocks.
+	class TextEventSink : public IEventSink {
+	private:
+		static constexpr size_t blockSize = 1 << 16;
+
+		std::ostream& _stream;
+		std::string _block;
+
+		void flushIfFull()
+		{
+			if (_block.size() >= blockSize)
+				flush();
+		}
+
+	public:
+		explicit TextEventSink(std::ostream& stream);
+		~TextEventSink() override;
+
+		void write(const EventRecord& record) override;
+		void flush() override;
+		TextEventSink* textSink() override
+		{
+			return this;
+		}
+
+		//! \brief Print the event straight from its fields, see EventLog::log.
+		template <class TEvent>
+		void print(uint64_t tick, TEvent& event)
+		{
+			formatEvent(_block, tick, event);
+			flushIfFull();
+		}
+
+		//! \brief Print the blank line ending the tick.
+		void endTick()
+		{
+			_block.push_back('\n');
+			flushIfFull();
+		}
+	};
+
+	//! \brief Prints events as text into a file.
+	class TextFileEventSink : public IEventSink {
+	private:
+		std::ofstream _file;
+		TextEventSink _text;
+
+	public:
+		explicit TextFileEventSink(const std::string& filename);
+
+		void write(const EventRecord& record) override;
+		void flush() override;
+		TextEventSink* textSink() override
+		{
+			return &_text;
+		}
+	};
+
+	//! \brief Passes the chosen event types to the next sink. Ends of ticks always pass.
+	class FilterEventSink : public IEventSink {
+	private:
+		std::unique_ptr<IEventSink> _next;
+		uint64_t _accepted;
+
+	public:
+		FilterEventSink(std::unique_ptr<IEventSink> next, uint64_t acceptedTypes);
+
+		void write(const EventRecord& record) override;
+		void flush() override;
+
+		/*! \brief Mask of event types by their names, e.g. UNIT_DIED.
+			\exception std::runtime_error if a name is unknown.
+		*/
+		static uint64_t typesMask(const std::vector<std::string>& names);
+	};
+
+	struct AsyncLogOptions
+	{
+		//! \brief What the simulation does when the writer falls behind and the queue is full.
+		enum class Overflow
+		{
+			block,	// wait for the writer
+			drop	// drop the record and count it
+		};
+
+		Overflow overflow = Overflow::block;
+		//! \brief Records the queue holds.
+		size_t capacity = 1 << 16;
+	};
+
+	//! \brief Sink chain chosen at startup.
+	struct EventSinkOptions
+	{
+		enum class Target
+		{
+			none,		// events are dropped before they are packed
+			standardOutput,
+			textFile,
+			binaryFile
+		};
+
+		Target target = Target::standardOutput;
+		//! \brief File of textFile and binaryFile targets.
+		std::string path;
+		//! \brief Names of the event types to log. All if empty.
+		std::vector<std::string> events;
+		//! \brief Write events on a background thread.
+		bool async = false;
+		AsyncLogOptions asyncOptions;
+	};
+
+	/*! \brief Build the sink chain: filter, then background writer, then the target.
+		\return nullptr for Target::none.
+	*/
+	std::unique_ptr<IEventSink> createEventSink(const EventSinkOptions& options);
+}
@@ -0,0 +1,68 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#define SW_HAS_MMAP 1
+#else
+	#define SW_HAS_MMAP 0
+#endif
+
+namespace sw
+{
+	MappedFile::MappedFile(const std::string& filename)
+	{
+#if SW_HAS_MMAP
+		const int descriptor = ::open(filename.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			return;
+		struct stat status {};
+		if (::fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0)
+		{
+			void* address = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (address != MAP_FAILED)
+			{
+				::madvise(address, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+				_data = static_cast<const char*>(address);
+				_size = static_cast<size_t>(status.st_size);
+				_mapped = true;
+			}
+		}
+		::close(descriptor);
+		if (_mapped)
+		{
+			_open = true;
+			return;
+		}
+#endif
+		//Empty files, pipes and systems without mmap.
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+			return;
+		constexpr size_t blockSize = 1 << 20;
+		size_t read = 0;
+		do
+		{
+			_buffer.resize(read + blockSize);
+			file.read(_buffer.data() + read, blockSize);
+			read += static_cast<size_t>(file.gcount());
+		}
+		while (file);
+		_buffer.resize(read);
+		_data = _buffer.data();
+		_size = _buffer.size();
+		_open = true;
+	}
+
+	MappedFile::~MappedFile()
+	{
+#if SW_HAS_MMAP
+		if (_mapped)
+			::munmap(const_cast<char*>(_data), _size);
+#endif
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace sw
+{
+	/*! \brief Read-only view of a whole file. The file is memory-mapped where the system allows it,
+		otherwise read into memory in large blocks.
+	*/
+	class MappedFile {
+	private:
+		const char* _data {};
+		size_t _size {};
+		bool _mapped {};
+		bool _open {};
+		std::string _buffer;
+
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::string& filename);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		//! \brief Check if the file has been opened.
+		bool isOpen() const
+		{
+			return _open;
+		}
+
+		std::string_view text() const
+		{
+			return { _data, _size };
+		}
+	};
+}
@@ -1,23 +1,90 @@
 #pragma once
 
-#include <iostream>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace sw
 {
+	/*! \brief Extracts fields of a command from the rest of its line.
+		Fields are read as `std::istream >> field` reads them: leading whitespace is skipped, a number may have a sign,
+		a malformed field becomes 0, an out of range one the largest value, and once a field fails or the line ends
+		the remaining fields keep their values.
+	*/
 	class CommandParserVisitor {
 	private:
-		std::istream& _stream;
+		std::string_view _rest;
+		bool _failed {};
+
+		static bool isSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+		}
+
+		//! \return false if the line has ended.
+		bool skipSpaces()
+		{
+			size_t position = 0;
+			while (position < _rest.size() && isSpace(_rest[position]))
+				++position;
+			_rest.remove_prefix(position);
+			return !_rest.empty();
+		}
 
 	public:
-		CommandParserVisitor(std::istream& stream) :
-			_stream(stream)
+		explicit CommandParserVisitor(std::string_view rest) :
+			_rest(rest)
 		{
 		}
 
 		template <class TField>
 		void visit(const char*, TField& field)
 		{
-			_stream >> field;
+			static_assert(std::is_integral_v<TField> && std::is_unsigned_v<TField>, "Unsupported command field type");
+			if (_failed)
+				return;
+			if (!skipSpaces())
+			{
+				_failed = true;
+				return;
+			}
+			const bool negative = _rest.front() == '-';
+			if (negative || _rest.front() == '+')
+				_rest.remove_prefix(1);
+
+			const auto [end, error] = std::from_chars(_rest.data(), _rest.data() + _rest.size(), field);
+			_rest.remove_prefix(static_cast<size_t>(end - _rest.data()));
+			if (error == std::errc::invalid_argument)
+			{
+				field = 0;
+				_failed = true;
+			}
+			else if (error == std::errc::result_out_of_range)
+			{
+				field = static_cast<TField>(~TField());
+				_failed = true;
+			}
+			else if (negative)
+			{
+				field = static_cast<TField>(TField() - field);
+			}
+		}
+
+		void visit(const char*, std::string& field)
+		{
+			if (_failed)
+				return;
+			if (!skipSpaces())
+			{
+				_failed = true;
+				return;
+			}
+			size_t length = 0;
+			while (length < _rest.size() && !isSpace(_rest[length]))
+				++length;
+			field.assign(_rest.substr(0, length));
+			_rest.remove_prefix(length);
 		}
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <charconv>
+#include <stdexcept>
+
+namespace sw
+{
+	//! \brief Field values of an event record. Strings are kept as indexes in the string pool.
+	struct RecordFields
+	{
+		static constexpr uint8_t capacity = 6;
+
+		uint32_t values[capacity] {};
+		uint8_t count {};
+	};
+
+	//! \brief Intern a string logged by an event. Thread safe.
+	uint32_t internString(const std::string& value);
+
+	//! \brief Get the interned string. Thread safe.
+	const std::string& internedString(uint32_t index);
+
+	class PackFieldVisitor {
+	private:
+		RecordFields& _fields;
+
+		void push(uint32_t value)
+		{
+			if (_fields.count == RecordFields::capacity)
+				throw std::logic_error("Too many fields in event");
+			_fields.values[_fields.count++] = value;
+		}
+
+	public:
+		explicit PackFieldVisitor(RecordFields& fields) :
+			_fields(fields)
+		{
+		}
+
+		void visit(const char*, uint32_t value)
+		{
+			push(value);
+		}
+
+		void visit(const char*, const std::string& value)
+		{
+			push(internString(value));
+		}
+	};
+
+	class UnpackFieldVisitor {
+	private:
+		const RecordFields& _fields;
+		uint8_t _next {};
+
+		uint32_t pop()
+		{
+			if (_next == _fields.count)
+				throw std::logic_error("Too few fields in event record");
+			return _fields.values[_next++];
+		}
+
+	public:
+		explicit UnpackFieldVisitor(const RecordFields& fields) :
+			_fields(fields)
+		{
+		}
+
+		void visit(const char*, uint32_t& value)
+		{
+			value = pop();
+		}
+
+		void visit(const char*, std::string& value)
+		{
+			value = internedString(pop());
+		}
+	};
+
+	//! \brief Same text as PrintFieldVisitor, appended to a string instead of a stream.
+	class AppendFieldVisitor {
+	private:
+		std::string& _out;
+
+	public:
+		explicit AppendFieldVisitor(std::string& out) :
+			_out(out)
+		{
+		}
+
+		void visit(const char* name, uint32_t value)
+		{
+			char digits[16];
+			const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+			_out.append(name).append(1, '=').append(digits, result.ptr).append(1, ' ');
+		}
+
+		void visit(const char* name, const std::string& value)
+		{
+			_out.append(name).append(1, '=').append(value).append(1, ' ');
+		}
+	};
+}
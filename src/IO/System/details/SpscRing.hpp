@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+namespace sw
+{
+	/*! \brief Bounded lock-free queue for exactly one producer thread and one consumer thread.
+		Each side caches the index of the other one, touching the shared cache line only
+		when the cached value says the queue looks full (producer) or empty (consumer).
+	*/
+	template <class T>
+	class SpscRing {
+	private:
+		static constexpr size_t cacheLine = 64;
+
+		const size_t _mask;
+		std::unique_ptr<T[]> _items;
+
+		alignas(cacheLine) std::atomic<size_t> _tail { 0 };
+		size_t _cachedHead { 0 };
+
+		alignas(cacheLine) std::atomic<size_t> _head { 0 };
+		size_t _cachedTail { 0 };
+
+		static size_t roundUp(size_t capacity)
+		{
+			size_t result = 2;
+			while (result < capacity)
+				result <<= 1;
+			return result;
+		}
+
+	public:
+		//! \brief Capacity is rounded up to a power of two.
+		explicit SpscRing(size_t capacity) :
+			_mask(roundUp(capacity) - 1),
+			_items(new T[_mask + 1])
+		{
+		}
+
+		size_t capacity() const
+		{
+			return _mask + 1;
+		}
+
+		//! \brief Producer side. \return false if the queue is full.
+		bool tryPush(const T& item)
+		{
+			const auto tail = _tail.load(std::memory_order_relaxed);
+			if (tail - _cachedHead > _mask)
+			{
+				_cachedHead = _head.load(std::memory_order_acquire);
+				if (tail - _cachedHead > _mask)
+					return false;
+			}
+			_items[tail & _mask] = item;
+			_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		//! \brief Consumer side. \return true if there is nothing to pop.
+		bool empty() const
+		{
+			return _head.load(std::memory_order_relaxed) == _tail.load(std::memory_order_acquire);
+		}
+
+		//! \brief Consumer side. \return false if the queue is empty.
+		bool tryPop(T& item)
+		{
+			const auto head = _head.load(std::memory_order_relaxed);
+			if (head == _cachedTail)
+			{
+				_cachedTail = _tail.load(std::memory_order_acquire);
+				if (head == _cachedTail)
+					return false;
+			}
+			item = _items[head & _mask];
+			_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+	};
+}
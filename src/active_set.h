@@ -0,0 +1,244 @@
+#ifndef __ACTIVE_SET_H__
+#define __ACTIVE_SET_H__
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "helper.h"
+#include "occupancy.h"
+
+namespace sw
+{
+
+/*
+    Active-set scheduling of a tick.
+
+    A unit steps only while it has something to do: it marches, or it attacked on its last step.
+    Otherwise it is idle and watches the cells its next step depends on:
+        - its own cell, which it writes back to the occupancy index on every step;
+        - the cells it would search for a unit to attack, for living units only.
+    Stepping an idle unit changes nothing until one of these cells changes, so it is skipped until a unit
+    occupies or vacates such a cell, or a march command arrives. A unit woken this way steps on this tick
+    if its turn is still to come, on the next tick otherwise: exactly when it would have stepped anyway.
+    Units step in the order of their slots, as if every unit stepped.
+    Living units go idle only with BattleFieldOptions::idle_units: otherwise a unit at the end of its march
+    logs MARCH_ENDED on every step, so it steps on every tick.
+*/
+class ActiveSet
+{
+public:
+    //! \brief Radius of the widest watch. A unit searching farther never goes idle.
+    static constexpr uint32_t kMaxWatchRadius = 64;
+    static constexpr uint32_t kTileShift = 4;
+
+    //! \brief Queue a new unit: every unit steps at least once after it is spawned.
+    void Add(uint32_t slot)
+    {
+        if(slot >= queued_.size())
+        {
+            queued_.resize(slot + 1, false);
+            epochs_.resize(slot + 1, 0);
+        }
+        Wake(slot);
+    }
+    /*! \brief Make the unit step: on this tick if its turn is still to come, on the next one otherwise.
+        Drops the watch of the unit.
+    */
+    void Wake(uint32_t slot)
+    {
+        if(queued_[slot])
+        {
+            return;
+        }
+        queued_[slot] = true;
+        ++epochs_[slot];
+        if(ticking_ && (!stepped_ || slot > current_))
+        {
+            now_.push(slot);
+        }
+        else
+        {
+            next_.push_back(slot);
+        }
+    }
+    /*! \brief Leave the unit idle until a cell it depends on changes.
+        \param radius Cells within this Chebyshev distance wake it when occupied by a living unit, 0 for its own cell only.
+    */
+    void Watch(uint32_t slot, const Coord& cell, uint32_t radius)
+    {
+        if(radius > kMaxWatchRadius)
+        {
+            Wake(slot);
+            return;
+        }
+        const Watcher watcher{ slot, epochs_[slot], cell, radius };
+        const uint64_t x_from = cell.x > radius ? (cell.x - radius) >> kTileShift : 0;
+        const uint64_t y_from = cell.y > radius ? (cell.y - radius) >> kTileShift : 0;
+        const uint64_t x_to = (static_cast<uint64_t>(cell.x) + radius) >> kTileShift;
+        const uint64_t y_to = (static_cast<uint64_t>(cell.y) + radius) >> kTileShift;
+        for(auto x = x_from; x <= x_to; ++x)
+        {
+            for(auto y = y_from; y <= y_to; ++y)
+            {
+                tiles_[Key(x, y)].push_back(watcher);
+                ++watches_;
+            }
+        }
+        ++watching_;
+    }
+    /*! \brief A unit occupied or vacated the cell: wake the units watching it.
+        \param target True if a living unit occupied the cell, so units around may attack it.
+    */
+    void Touch(const Coord& cell, bool target)
+    {
+        if(!watches_)
+        {
+            return;
+        }
+        const auto iter = tiles_.find(Key(cell.x >> kTileShift, cell.y >> kTileShift));
+        if(iter == tiles_.end())
+        {
+            return;
+        }
+        auto& watchers = iter->second;
+        for(size_t i = 0; i < watchers.size();)
+        {
+            const auto& watcher = watchers[i];
+            if(watcher.epoch == epochs_[watcher.slot])
+            {
+                const bool own_cell = watcher.cell == cell;
+                if(!own_cell && !(target && Distance(watcher.cell, cell) <= watcher.radius))
+                {
+                    ++i;
+                    continue;
+                }
+                --watching_;
+                Wake(watcher.slot);
+            }
+            //Woken or stale.
+            watchers[i] = watchers.back();
+            watchers.pop_back();
+            --watches_;
+        }
+        if(watchers.empty())
+        {
+            tiles_.erase(iter);
+        }
+    }
+    //! \brief Start a tick with the units queued for it.
+    void BeginTick()
+    {
+        std::sort(next_.begin(), next_.end());
+        ticking_list_.swap(next_);
+        next_.clear();
+        position_ = 0;
+        current_ = 0;
+        stepped_ = false;
+        ticking_ = true;
+        Compact();
+    }
+    //! \brief Units queued when the tick began, in the order of their slots.
+    const std::vector<uint32_t>& Ticking() const
+    {
+        return ticking_list_;
+    }
+    /*! \brief Take the next unit to step on this tick.
+        \param [out] queued True if the unit was queued when the tick began, see Ticking.
+        \return kNoSlot when no unit is left.
+    */
+    uint32_t Next(bool& queued)
+    {
+        const bool listed = position_ < ticking_list_.size();
+        if(!listed && now_.empty())
+        {
+            ticking_ = false;
+            return kNoSlot;
+        }
+        queued = listed && (now_.empty() || ticking_list_[position_] < now_.top());
+        if(queued)
+        {
+            current_ = ticking_list_[position_++];
+        }
+        else
+        {
+            current_ = now_.top();
+            now_.pop();
+        }
+        queued_[current_] = false;
+        stepped_ = true;
+        return current_;
+    }
+private:
+    struct Watcher
+    {
+        uint32_t slot = 0;
+        //Epoch of the unit when it started watching. The watch is stale when the unit has been woken since.
+        uint32_t epoch = 0;
+        Coord cell;
+        uint32_t radius = 0;
+    };
+
+    static uint64_t Key(uint64_t x, uint64_t y)
+    {
+        return (x << 32) | y;
+    }
+    static uint32_t Distance(const Coord& a, const Coord& b)
+    {
+        const auto dx = a.x > b.x ? a.x - b.x : b.x - a.x;
+        const auto dy = a.y > b.y ? a.y - b.y : b.y - a.y;
+        return std::max(dx, dy);
+    }
+    //! \brief Drop stale watches once they outnumber the live ones.
+    void Compact()
+    {
+        if(watches_ <= 2 * static_cast<uint64_t>(watching_) + 1024)
+        {
+            return;
+        }
+        watching_ = 0;
+        watches_ = 0;
+        std::vector<uint32_t> seen;
+        for(auto iter = tiles_.begin(); iter != tiles_.end();)
+        {
+            auto& watchers = iter->second;
+            watchers.erase(std::remove_if(watchers.begin(), watchers.end(), [this](const Watcher& watcher)
+            {
+                return watcher.epoch != epochs_[watcher.slot];
+            }), watchers.end());
+            for(const auto& watcher : watchers)
+            {
+                seen.push_back(watcher.slot);
+            }
+            watches_ += watchers.size();
+            iter = watchers.empty() ? tiles_.erase(iter) : std::next(iter);
+        }
+        std::sort(seen.begin(), seen.end());
+        watching_ = static_cast<uint32_t>(std::unique(seen.begin(), seen.end()) - seen.begin());
+    }
+private:
+    //By slot: queued to step on this or the next tick, and the number of times the unit has been woken.
+    std::vector<bool> queued_;
+    std::vector<uint32_t> epochs_;
+
+    std::vector<uint32_t> ticking_list_;
+    size_t position_ = 0;
+    //Woken on this tick after the tick began.
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> now_;
+    std::vector<uint32_t> next_;
+    //Unit stepping now, if stepped_.
+    uint32_t current_ = 0;
+    bool stepped_ = false;
+    bool ticking_ = false;
+
+    //Watches by tile of the cells they cover. A watch covering several tiles is stored in each of them.
+    std::unordered_map<uint64_t, std::vector<Watcher>> tiles_;
+    uint64_t watches_ = 0;
+    //Units watching.
+    uint32_t watching_ = 0;
+};
+
+}//namespace sw
+
+#endif /*__ACTIVE_SET_H__*/
@@ -2,6 +2,8 @@
 #define __ACTORS_H__
 #include <set>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <IO/Commands/CreateMap.hpp>
 #include <IO/Commands/SpawnWarrior.hpp>
 #include <IO/Commands/SpawnArcher.hpp>
@@ -9,6 +11,7 @@
 
 #include <IO/System/PrintDebug.hpp>
 #include <IO/System/EventLog.hpp>
+#include "profiler.h"
 
 namespace sw
 {
@@ -16,6 +19,9 @@ namespace sw
 //! \brief Throw std::runtime_error if condition is false.
 void Expected(bool condition, const char* message);
 
+/*! \brief Events and the tick counter of one battle.
+    Each battle owns its logger, so independent battles share no mutable state.
+*/
 class Logger
 {
 public:
@@ -25,18 +31,61 @@ public:
     template<typename TEvent>
     void Log(TEvent&& evt)
     {
+        const ProfileScope scope(profiler_, ProfilePhase::logging);
         log_.log(tick_, std::move(evt));
     }
+    //! \brief Current tick.
+    uint64_t Tick() const
+    {
+        return tick_;
+    }
+    //! \brief Continue the ticks of a battle restored from a snapshot.
+    void SetTick(uint64_t tick)
+    {
+        tick_ = tick;
+    }
+    //! \brief End the current tick with a blank line and start the next one.
     void NextTick()
     {
+        log_.endTick(tick_);
         ++tick_;
     }
+    //! \brief Send events to the sink chain from now on, see createEventSink.
+    void SetSink(std::unique_ptr<IEventSink> sink)
+    {
+        log_.setSink(std::move(sink));
+    }
+    //! \brief Wait until all events logged are written.
+    void Flush()
+    {
+        log_.flush();
+    }
+    /*! \brief Profile the ticks of the battle from now on. nullptr stops profiling.
+        The battle field and its units find the profiler here. Calls compile to nothing when SW_PROFILE is 0.
+    */
+    void SetProfiler(TickProfiler* profiler)
+    {
+        profiler_ = profiler;
+    }
+    TickProfiler* Profiler() const
+    {
+        return TickProfiler::kEnabled ? profiler_ : nullptr;
+    }
 private:
     uint64_t tick_;
     sw::EventLog log_;
+    TickProfiler* profiler_ = nullptr;
 };
 
-Logger* AcquireLogger();
+//! \brief State of a battle field for diagnostics.
+struct BattleFieldDiagnostics
+{
+    //! \brief Layout of the occupancy index chosen for the map, see occupancy.h.
+    const char* occupancy = "";
+    //! \brief Bytes allocated by the occupancy index and its bitboard now, see occupancy_bits.h.
+    uint64_t occupancy_memory = 0;
+    uint32_t units = 0;
+};
 
 //! \brief Public interface to operate on.
 class IBattleField
@@ -53,17 +102,74 @@ public:
     //! \brief Start march of the unit specified in `march` argument.
     virtual void MarchTo(const io::March& march) = 0;
 
-    /*! \brief Enforce all actors to do next step.
+    /*! \brief Enforce all actors to do next step. Dead units, and units with nothing to do if BattleFieldOptions::idle_units,
+        are skipped until something around them changes, see active_set.h.
         \return true if further steps may be done. False otherwise.
     */
     virtual bool DoNextStep() = 0;
+
+    /*! \brief Save the complete state of the battle between two ticks, see snapshot.h.
+        \param out Replaced with the snapshot. Its memory is reused from one checkpoint to the next.
+    */
+    virtual void Checkpoint(std::string& out) const = 0;
+
+    /*! \brief Hash of the id, hp and cell of every unit, see state_hash.h. Engines give the same hash for the same state.
+        \return 0 if BattleFieldOptions::state_hash is not set.
+    */
+    virtual uint64_t StateHash() const = 0;
+
+    //! \brief Describe how the battle field is laid out.
+    virtual BattleFieldDiagnostics Diagnostics() const = 0;
+};
+
+//! \brief Settings of a battle field.
+struct BattleFieldOptions
+{
+    /*! \brief Engine simulating the units. Engines produce the same events.
+    */
+    enum engine_t
+    {
+        classic,    //!< Units kept as std::variant values of the kinds listed in UnitKindList, Warrior and Archer.
+        soa         //!< Units kept as structure of arrays.
+    };
+    engine_t engine = classic;
+    /*! \brief Threads of the two-phase tick of the classic engine: units plan their attacks in parallel, then step
+        in order. Events are the same as with the sequential tick. 0 or 1 means sequential.
+    */
+    uint32_t threads = 0;
+    //! \brief Keep the hash of the state up to date as units step, see IBattleField::StateHash.
+    bool state_hash = false;
+    /*! \brief Number of units expected, 0 if unknown. The occupancy index is chosen from the area of the map
+        and the number of units: a dense grid for small or crowded maps, sparse tiles for huge and mostly empty ones.
+    */
+    uint64_t expected_units = 0;
+    /*! \brief Let units with nothing to do idle until something around them changes. This changes the events:
+        MARCH_ENDED is logged once per march instead of on every tick the unit stands at its target,
+        and a unit without a march waits at its spawn cell instead of failing with an internal error.
+        Otherwise only dead units are skipped, see active_set.h. Always on for a stream of commands, see SimulatingMachine::RunStream.
+    */
+    bool idle_units = false;
 };
 
 /*! \brief Create a new battle field.
+    \param logger Logger of the battle the field and its units log to. Must outlive the battle field.
     \return IBattleField pointer. Never returns nullptr.
     \exception std::runtime error if CreateMap::width or Create::height equals to 0.
 */
-std::unique_ptr<IBattleField> CreateBattleField(const io::CreateMap&);
+std::unique_ptr<IBattleField> CreateBattleField(const io::CreateMap&, Logger& logger, const BattleFieldOptions& options = {});
+
+/*! \brief Restore a battle field from a snapshot made by IBattleField::Checkpoint, with any engine.
+    Nothing is logged; the tick of the logger is set to the tick of the snapshot.
+    \param snapshot Snapshot data, e.g. a mapped file. Not used after the call.
+    \exception std::runtime_error if the snapshot is malformed or written by an incompatible build.
+*/
+std::unique_ptr<IBattleField> RestoreBattleField(std::string_view snapshot, Logger& logger, const BattleFieldOptions& options = {});
+
+/*! \brief Memory the battle field allocates upfront to index unit positions.
+    \param units Expected number of units, see BattleFieldOptions::expected_units.
+    \return Size in bytes. Depends on the layout chosen for the map: a flat grid, a directory of tiles or sparse tiles.
+*/
+uint64_t OccupancyMemory(const io::CreateMap&, uint64_t units = 0);
 
 }//namespace sw
 
@@ -1,6 +1,8 @@
 #include <vector>
-#include <map>
+#include <variant>
+#include <type_traits>
 #include <algorithm>
+#include <atomic>
 
 #include <IO/Commands/SpawnWarrior.hpp>
 #include <IO/Commands/SpawnArcher.hpp>
@@ -16,43 +18,52 @@
 
 #include "actors.h"
 #include "actors_internal.h"
+#include "actors_soa.h"
+#include "occupancy.h"
+#include "occupancy_bits.h"
+#include "rings.h"
+#include "id_index.h"
+#include "active_set.h"
+#include "snapshot.h"
+#include "state_hash.h"
+#include "unit_scan.h"
+#include "step_plan.h"
+#include "task_pool.h"
 
 namespace sw
 {
 
-
-
-Logger* AcquireLogger()
-{
-    static Logger log;
-    return &log;
-}
-
 //Some common implementations
 template<typename TCommandData>
 class UnitImpl : public IUnitInternal
 {
 public:
-    UnitImpl(IBattleFieldInternal* field, const TCommandData& data)
+    //! \brief Command spawning units of this kind.
+    using Command = TCommandData;
+
+    //! \param idle See BattleFieldOptions::idle_units.
+    UnitImpl(IBattleFieldInternal* field, Logger* logger, const TCommandData& data, bool idle)
         :   field_(field)
+        ,   logger_(logger)
         ,   cmddata_(data)
-        ,   iter_(path_.end())
+        ,   idle_(idle)
     {
         CheckFatal(!!field_);
+        CheckFatal(!!logger_);
     }
     void MarchTo(const Coord& target) override
     {
         path_ = field_->AcquirePath({cmddata_.x, cmddata_.y}, target);
-        iter_ = path_.begin();
-        AcquireLogger()->Log(io::MarchStarted { cmddata_.unitId, cmddata_.x, cmddata_.y, target.x, target.y });
+        march_ended_ = false;
+        logger_->Log(io::MarchStarted { cmddata_.unitId, cmddata_.x, cmddata_.y, target.x, target.y });
     }
     void DoAttack(const Attack& attack) override
     {
         cmddata_.hp = (attack.damage > cmddata_.hp) ? 0 : cmddata_.hp - attack.damage;
-        AcquireLogger()->Log(io::UnitAttacked{attack.attacker_id, cmddata_.unitId, attack.damage, cmddata_.hp });
+        logger_->Log(io::UnitAttacked{attack.attacker_id, cmddata_.unitId, attack.damage, cmddata_.hp });
         if(Dead())
         {
-            AcquireLogger()->Log(io::UnitDied{ cmddata_.unitId });
+            logger_->Log(io::UnitDied{ cmddata_.unitId });
         }
     }
     uint32_t Id() const override
@@ -63,7 +74,11 @@ public:
     {
         return !cmddata_.hp;
     }
-    Coord CurrentPosition() const
+    uint32_t Hp() const
+    {
+        return cmddata_.hp;
+    }
+    Coord CurrentPosition() const override
     {
         return get_my_pos();
     }
@@ -71,47 +86,99 @@ public:
     {
         return attack.type == Attack::arrow || attack.type == Attack::close_combat;
     }
+    //! \brief State of the unit for a snapshot.
+    SnapshotUnit Save() const
+    {
+        auto unit = MakeSnapshotUnit(cmddata_);
+        unit.path = path_.Save();
+        unit.march_ended = march_ended_;
+        return unit;
+    }
+    //! \brief Continue the march saved in a snapshot.
+    void Restore(const SnapshotUnit& unit)
+    {
+        path_ = PathCursor(unit.path);
+        march_ended_ = unit.march_ended != 0;
+    }
 protected:
     Coord get_my_pos() const
     {
-        if(path_.empty())
+        if(path_.Empty())
         {
             return { cmddata_.x, cmddata_.y };
         }
-        CheckFatal(iter_ != path_.end());
-        return *iter_;
+        return path_.Current();
+    }
+    //! \brief A unit must have been given a march before it steps, unless units may idle.
+    void CheckMarch() const
+    {
+        CheckFatal(idle_ || !path_.Empty());
+    }
+    /*! \brief Step along the path when there is nothing to attack. The end of the march is logged on every step
+        the unit stands there; when units may idle, once per march, and a unit without a march stays.
+    */
+    Coord MarchStep(const Coord& my_pos, bool& further)
+    {
+        if(path_.Empty() || path_.AtEnd())
+        {
+            further = false;
+            if(!path_.Empty() && !(idle_ && march_ended_))
+            {
+                march_ended_ = true;
+                logger_->Log(io::MarchEnded{cmddata_.unitId, my_pos.x, my_pos.y});
+            }
+            return my_pos;
+        }
+        path_.Advance();
+        const auto next_pos = path_.Current();
+        logger_->Log(io::UnitMoved{cmddata_.unitId, next_pos.x, next_pos.y});
+        further = true;
+        return next_pos;
     }
 protected:
     IBattleFieldInternal* field_;
+    Logger* logger_;
     TCommandData cmddata_;
-    std::vector<Coord> path_;
-    std::vector<Coord>::iterator iter_;
+    PathCursor path_;
+    bool march_ended_ = false;
+    bool idle_;
 };
 
 //Specific implementation for each unit.
 
-class Warrior : public UnitImpl<io::SpawnWarrior>
+class Warrior final : public UnitImpl<io::SpawnWarrior>
 {
 public:
-    Warrior(IBattleFieldInternal* field, const io::SpawnWarrior& warrior)
-        :   UnitImpl(field, warrior)
+    Warrior(IBattleFieldInternal* field, Logger* logger, const io::SpawnWarrior& warrior, bool idle)
+        :   UnitImpl(field, logger, warrior, idle)
     {
         ;
     }
+    /*! \brief Make the searches NextStep is going to make, without acting.
+        \param scan bool(const Coord& center, uint32_t radius_from, uint32_t radius_to), true if a unit to attack is found.
+    */
+    template<typename TScan>
+    void PlanStep(TScan&& scan) const
+    {
+        if(Dead())
+        {
+            return;
+        }
+        scan(get_my_pos(), 1, 1);
+    }
     Coord NextStep(bool& further) override
     {
-        CheckFatal(iter_ != path_.end());
+        CheckMarch();
         if(Dead())
         {
             further = false;
-            return *iter_;
+            return get_my_pos();
         }
         const auto my_pos = get_my_pos();
 
         //Check if can attack closely
         const uint32_t radius = 1;
-        const auto coordinates_around = field_->AcquireCoordinatesAround(my_pos, radius, radius);
-        auto* unit_to_attack = field_->GetUnitToAttack(coordinates_around);
+        auto* unit_to_attack = field_->FindUnitToAttack(my_pos, radius, radius);
         if(unit_to_attack)
         {
             Attack attack;
@@ -126,45 +193,52 @@ public:
             further = true;
             return my_pos;
         }
-        auto inext = std::next(iter_);
-        if(inext == path_.end())
-        {
-            further = false;
-            AcquireLogger()->Log(io::MarchEnded{cmddata_.unitId, iter_->x, iter_->y});
-            return *iter_;
-        }
         //If cannot attack, move to next cell.
-        ++iter_;
-        CheckFatal(iter_ != path_.end());
-        AcquireLogger()->Log(io::UnitMoved{cmddata_.unitId, iter_->x, iter_->y});
-        further = true;
-        return *iter_;
+        return MarchStep(my_pos, further);
+    }
+    //! \brief Distance of the farthest cell NextStep looks for a unit to attack.
+    uint32_t WatchRadius() const
+    {
+        return 1;
     }
 };
 
-class Archer : public UnitImpl<io::SpawnArcher>
+class Archer final : public UnitImpl<io::SpawnArcher>
 {
 public:
-    Archer(IBattleFieldInternal* field, const io::SpawnArcher& archer)
-        : UnitImpl(field, archer)
+    Archer(IBattleFieldInternal* field, Logger* logger, const io::SpawnArcher& archer, bool idle)
+        : UnitImpl(field, logger, archer, idle)
     {
         ;
     }
+    //! \brief Make the searches NextStep is going to make, without acting. See Warrior::PlanStep.
+    template<typename TScan>
+    void PlanStep(TScan&& scan) const
+    {
+        if(Dead())
+        {
+            return;
+        }
+        const auto my_pos = get_my_pos();
+        if(!scan(my_pos, 1, 1))
+        {
+            scan(my_pos, 2, cmddata_.range);
+        }
+    }
     Coord NextStep(bool& further) override
     {
-        CheckFatal(iter_ != path_.end());
+        CheckMarch();
         if(Dead())
         {
             further = false;
-            return *iter_;
+            return get_my_pos();
         }
 
         const auto my_pos = get_my_pos();
         //Check if can attack closely.
         {
             const uint32_t radius = 1;
-            const auto coordinates_around = field_->AcquireCoordinatesAround(my_pos, radius, radius);
-            auto* unit_to_attack = field_->GetUnitToAttack(coordinates_around);
+            auto* unit_to_attack = field_->FindUnitToAttack(my_pos, radius, radius);
             if(unit_to_attack)
             {
                 Attack attack;
@@ -184,8 +258,7 @@ public:
         {
             const uint32_t radius_from = 2;
             const uint32_t radius_to = cmddata_.range;
-            const auto coordinates_around = field_->AcquireCoordinatesAround(my_pos, radius_from, radius_to);
-            auto* unit_to_attack = field_->GetUnitToAttack(coordinates_around);
+            auto* unit_to_attack = field_->FindUnitToAttack(my_pos, radius_from, radius_to);
 
             if(unit_to_attack)
             {
@@ -202,173 +275,309 @@ public:
                 return my_pos;
             }
         }
-        if(std::next(iter_) == path_.end())
-        {
-            AcquireLogger()->Log(io::MarchEnded{cmddata_.unitId, iter_->x, iter_->y});
-            further = false;
-            return *iter_;
-        }
         //If cannot attack, move to next cell.
-        ++iter_;
-        CheckFatal(iter_ != path_.end());
-        AcquireLogger()->Log(io::UnitMoved{cmddata_.unitId, iter_->x, iter_->y});
-        further = true;
-        return *iter_;
+        return MarchStep(my_pos, further);
+    }
+    //! \brief Distance of the farthest cell NextStep looks for a unit to attack.
+    uint32_t WatchRadius() const
+    {
+        return std::max<uint32_t>(1, cmddata_.range);
     }
 };
 
-template<typename TCommandData>
-UnitPtr CreateUnit(IBattleFieldInternal* field, const TCommandData&);
+/*
+    Registry of unit kinds. A new kind is a class derived from UnitImpl plus an entry in UnitKinds;
+    units are stored by value in a std::variant of all kinds and dispatched with std::visit,
+    so calls made on each tick are resolved at compile time.
+*/
+template<typename... TKinds>
+struct UnitKindList
+{
+    using variant = std::variant<TKinds...>;
+    //! \brief Names of the kinds by their index in the variant.
+    static std::vector<std::string> Names()
+    {
+        return { TKinds::Command::Name... };
+    }
+};
 
-template<>
-UnitPtr CreateUnit<io::SpawnWarrior>(IBattleFieldInternal* field, const io::SpawnWarrior& warrior)
+//! \brief Find the kind spawned by the command TCommandData.
+template<typename TCommandData, typename TKindList>
+struct KindOf;
+
+template<typename TCommandData, typename TKind, typename... TKinds>
+struct KindOf<TCommandData, UnitKindList<TKind, TKinds...>>
 {
-    UnitPtr ptr;
-    ptr.reset(new Warrior(field, warrior));
-    return ptr;
-}
-template<>
-UnitPtr CreateUnit<io::SpawnArcher>(IBattleFieldInternal* field, const io::SpawnArcher& archer)
+    using type = std::conditional_t<
+        std::is_same_v<typename TKind::Command, TCommandData>,
+        TKind,
+        typename KindOf<TCommandData, UnitKindList<TKinds...>>::type>;
+};
+
+template<typename TCommandData>
+struct KindOf<TCommandData, UnitKindList<>>
 {
-    UnitPtr ptr;
-    ptr.reset(new Archer(field, archer));
-    return ptr;
-}
+    using type = void;
+};
+
+using UnitKinds = UnitKindList<Warrior, Archer>;
+using UnitVariant = UnitKinds::variant;
 
 class UnitStorage
 {
 public:
-    void StoreUnit(UnitPtr&& new_unit)
+    //! \brief Create unit of the kind spawned by TCommandData. \param idle See BattleFieldOptions::idle_units.
+    template<typename TCommandData>
+    void StoreUnit(IBattleFieldInternal* field, Logger* logger, const TCommandData& data, bool idle)
     {
-        CheckFatal(!!new_unit);
-        auto iter = std::find_if(units_.cbegin(), units_.cend(), [&new_unit](const auto& item) { return new_unit->Id() == item->Id(); });
-        CheckRt(iter == units_.cend(), "Unit already created");
-        units_.push_back(std::move(new_unit));
+        using Kind = typename KindOf<TCommandData, UnitKinds>::type;
+        static_assert(!std::is_void_v<Kind>, "Unit kind is not registered in UnitKinds");
+        CheckRt(ids_.Insert(data.unitId, NextSlot()), "Unit already created");
+        units_.emplace_back(std::in_place_type<Kind>, field, logger, data, idle);
     }
-    IUnitInternal* Get(uint32_t id) const
+    IUnitInternal* Get(uint32_t id)
     {
-        auto iter = std::find_if(units_.cbegin(), units_.cend(), [id](const auto& item) { return item->Id() == id; });
-        CheckFatal(iter != units_.end());
-        return iter->get();
+        return At(Slot(id));
     }
-    //Wrapper to iterate over UnitStorage directly.
-    class Iterator
+    uint32_t Slot(uint32_t id) const
     {
-    public:
-        Iterator(std::vector<UnitPtr>* units, bool start)
-            : units_(units)
-        {
-            iter_ = start
-                ? units_->begin()
-                : units_->end();
-        }
-        Iterator& operator++()
-        {
-            ++iter_;
-            return *this;
-        }
-        IUnitInternal* operator->()
-        {
-            CheckFatal(iter_ != units_->end());
-            return iter_->get();
-        }
-        IUnitInternal* operator*()
-        {
-            CheckFatal(iter_ != units_->end());
-            return iter_->get();
-        }
-    private:
-        std::vector<UnitPtr>* units_;
-        std::vector<UnitPtr>::iterator iter_;
-        friend bool operator==(const UnitStorage::Iterator& lv, const UnitStorage::Iterator& rv)
-        {
-            return lv.iter_ == rv.iter_;
-        }
-        friend bool operator!=(const UnitStorage::Iterator& lv, const UnitStorage::Iterator& rv)
-        {
-            return lv.iter_ != rv.iter_;
-        }
-    };
-    Iterator begin()
+        const auto slot = ids_.Find(id);
+        CheckFatal(slot != kNoSlot);
+        return slot;
+    }
+    //! \brief Call `visitor` with the unit in the slot as its exact kind.
+    template<typename TVisitor>
+    decltype(auto) Visit(uint32_t slot, TVisitor&& visitor)
+    {
+        CheckFatal(slot < units_.size());
+        return std::visit(std::forward<TVisitor>(visitor), units_[slot]);
+    }
+    template<typename TVisitor>
+    decltype(auto) Visit(uint32_t slot, TVisitor&& visitor) const
     {
-        return Iterator(&units_, /*start*/true);
+        CheckFatal(slot < units_.size());
+        return std::visit(std::forward<TVisitor>(visitor), units_[slot]);
     }
-    Iterator end()
+    //! \brief Index of the kind of the unit in UnitKinds.
+    uint32_t KindAt(uint32_t slot) const
     {
-        return Iterator(&units_, /*start*/false);
+        return static_cast<uint32_t>(units_[slot].index());
+    }
+    //! \brief Get unit by its slot, i.e. by the order it was stored in.
+    IUnitInternal* At(uint32_t slot)
+    {
+        return Visit(slot, [](auto& unit) -> IUnitInternal* { return &unit; });
+    }
+    //! \brief Slot the next stored unit will get.
+    uint32_t NextSlot() const
+    {
+        return static_cast<uint32_t>(units_.size());
     }
 
 private:
-    std::vector<UnitPtr> units_;
-    friend class Iterator;
+    std::vector<UnitVariant> units_;
+    IdIndex ids_;
 };
 
+/*! \brief Battle field.
+    \tparam TOccupancy Occupancy index, see occupancy.h.
+*/
+template<typename TOccupancy>
 class BattleField
     : public IBattleField
     , public IBattleFieldInternal
 {
 public:
-    BattleField(const io::CreateMap& amap)
+    //! \param snapshot Snapshot to restore the battle from, nullptr for a new battle.
+    BattleField(const io::CreateMap& amap, Logger& logger, const BattleFieldOptions& options, const SnapshotReader* snapshot)
         :   amap_(amap)
+        ,   logger_(logger)
+        ,   positions_(amap.width, amap.height)
+        ,   bits_(amap.width, amap.height)
+        ,   idle_units_(options.idle_units)
     {
         CheckRt(amap_.height && amap_.width, "Invalid arguments: height or width is zero");
-        AcquireLogger()->Log(io::MapCreated{amap_.width, amap_.height});
+        if(options.threads > 1)
+        {
+            pool_ = std::make_unique<TaskPool>(options.threads);
+        }
+        if(options.state_hash)
+        {
+            hash_ = std::make_unique<RollingStateHash>();
+        }
+        if(auto* profiler = logger_.Profiler())
+        {
+            profiler->SetKinds(UnitKinds::Names());
+        }
+        if(snapshot)
+        {
+            Restore(*snapshot);
+            return;
+        }
+        logger_.Log(io::MapCreated{amap_.width, amap_.height});
     }
     //IBattleField
     void AddUnit(const io::SpawnWarrior& warrior)
     {
-        auto ptr = CreateUnit(this, warrior);
-        AddUnitI(std::move(ptr), { warrior.x, warrior.y });
-        AcquireLogger()->Log(io::UnitSpawned{ warrior.unitId, warrior.Name, warrior.x, warrior.y});
+        AddUnitI(warrior);
     }
     void AddUnit(const io::SpawnArcher& archer)
     {
-        auto ptr = CreateUnit(this, archer);
-        AddUnitI(std::move(ptr), { archer.x, archer.y });
-        AcquireLogger()->Log(io::UnitSpawned{ archer.unitId, archer.Name, archer.x, archer.y});
+        AddUnitI(archer);
     }
     void MarchTo(const io::March& march)
     {
-        auto* unit = storage_.Get(march.unitId);
+        const auto slot = storage_.Slot(march.unitId);
+        auto* unit = storage_.At(slot);
         CheckRt(!!unit, "Unit not found");
         unit->MarchTo({ march.targetX, march.targetY });
+        active_.Wake(slot);
+    }
+    void Checkpoint(std::string& out) const override
+    {
+        const auto count = storage_.NextSlot();
+        SnapshotWriter writer(out, amap_, logger_.Tick(), count);
+        for(uint32_t slot = 0; slot < count; ++slot)
+        {
+            writer.Add(storage_.Visit(slot, [](const auto& unit) { return unit.Save(); }));
+        }
+        //Every occupied cell holds the unit standing there, so the units give the cells without a walk of the map.
+        for(uint32_t slot = 0; slot < count; ++slot)
+        {
+            const auto cell = storage_.Visit(slot, [](const auto& unit) { return unit.CurrentPosition(); });
+            if(positions_.Find(cell) == slot)
+            {
+                writer.Add(cell, slot);
+            }
+        }
+        writer.Finish();
+    }
+    uint64_t StateHash() const override
+    {
+        return hash_ ? hash_->Value() : 0;
+    }
+    BattleFieldDiagnostics Diagnostics() const override
+    {
+        BattleFieldDiagnostics diagnostics;
+        diagnostics.occupancy = OccupancyLayoutName(TOccupancy::kLayout);
+        diagnostics.occupancy_memory = positions_.MemoryUsage() + bits_.MemoryUsage();
+        diagnostics.units = storage_.NextSlot();
+        return diagnostics;
     }
     //IBattleFieldInternal
-    std::vector<Coord> AcquirePath(const Coord& mine, const Coord& target) override
+    PathCursor AcquirePath(const Coord& mine, const Coord& target) override
     {
-        return Bresenham(mine, target);
+        return PathCursor(mine, target);
     }
     std::vector<Coord> AcquireCoordinatesAround(const Coord& mine, uint32_t radius_from, uint32_t radius_to) override
     {
-        const Coord extreme_cell(amap_.width - 1, amap_.height - 1);
-        return CoordinatesAround(mine, extreme_cell, radius_from, radius_to);
+        const ProfileScope scope(logger_.Profiler(), ProfilePhase::neighbors);
+        std::vector<Coord> result;
+        ForEachCoordinateAround(rings_, mine, ExtremeCell(), radius_from, radius_to, [&result](const Coord& coord)
+        {
+            result.push_back(coord);
+            return false;
+        });
+        return result;
     }
     bool DoNextStep() override
     {
+        auto* profiler = logger_.Profiler();
+        const TickProfileScope tick_scope(profiler, logger_.Tick());
+        active_.BeginTick();
+        const bool planned = pool_ && active_.Ticking().size() > 1;
+        if(planned)
+        {
+            const ProfileScope scope(profiler, ProfilePhase::plan);
+            PlanSteps();
+        }
         int further(0);
-        for(auto* unit : storage_)
+        bool queued(false);
+        for(auto slot = active_.Next(queued); slot != kNoSlot; slot = active_.Next(queued))
         {
-            const auto current_pos = unit->CurrentPosition();
-            positions_.erase(current_pos);
+            const ProfileScope unit_scope(profiler, ProfilePhase::movement, storage_.KindAt(slot));
+            storage_.Visit(slot, [this, profiler, slot, planned, queued, &further](auto& unit)
+            {
+                const auto current_pos = unit.CurrentPosition();
+                auto previous = kNoSlot;
+                {
+                    const ProfileScope scope(profiler, ProfilePhase::occupancy);
+                    previous = planned ? positions_.Find(current_pos) : kNoSlot;
+                    positions_.Vacate(current_pos);
+                }
+
+                //Units woken during the tick have not been planned.
+                stepping_ = planned && queued ? &plans_[slot] : nullptr;
+                attacked_ = kNoSlot;
+                bool further_step(false);
+                const auto new_pos = unit.NextStep(further_step);
+                further += static_cast<int>(further_step);
+                {
+                    const ProfileScope scope(profiler, ProfilePhase::occupancy);
+                    positions_.Occupy(new_pos, slot);
+                    //Woken units step after this one either way, so both cells are touched once the step is done.
+                    if(!(new_pos == current_pos))
+                    {
+                        active_.Touch(current_pos, false);
+                    }
+                    active_.Touch(new_pos, !unit.Dead());
+                }
+                stepping_ = nullptr;
+                if(!(new_pos == current_pos))
+                {
+                    bits_.Set(current_pos, false);
+                }
+                TrackUnit(slot);
+                if(attacked_ != kNoSlot)
+                {
+                    TrackUnit(attacked_);
+                }
+                if(further_step || !(idle_units_ || unit.Dead()))
+                {
+                    //Unless units may idle, a living unit logs the end of its march again on its next step.
+                    active_.Wake(slot);
+                }
+                else
+                {
+                    //A dead unit only writes its cell back.
+                    active_.Watch(slot, new_pos, unit.Dead() ? 0 : unit.WatchRadius());
+                }
 
-            bool further_step(false);
-            const auto new_pos = unit->NextStep(further_step);
-            further += static_cast<int>(further_step);
-            positions_[new_pos] = unit->Id();
+                if(planned)
+                {
+                    if(!(new_pos == current_pos) || previous != slot)
+                    {
+                        dirty_.Mark(current_pos);
+                        dirty_.Mark(new_pos);
+                    }
+                    if(attacked_ != kNoSlot && storage_.At(attacked_)->Dead())
+                    {
+                        dirty_.Mark(storage_.At(attacked_)->CurrentPosition());
+                    }
+                }
+            });
         }
         return (further > 1);
     }
     IUnitInternal* GetUnitToAttack(const std::vector<Coord>& coords)
     {
+        auto* profiler = logger_.Profiler();
+        const ProfileScope scope(profiler, ProfilePhase::target);
+        if constexpr (TickProfiler::kEnabled)
+        {
+            if(profiler)
+            {
+                profiler->AddCells(coords.size());
+            }
+        }
         for(const auto& coord : coords)
         {
-            auto iter = positions_.find(coord);
-            if(iter == positions_.end())
+            const auto slot = positions_.Find(coord);
+            if(slot == kNoSlot)
             {
                 continue;
             }
-            const int32_t id = iter->second;
-            auto* unit = storage_.Get(id);
+            auto* unit = storage_.At(slot);
             if(!unit->Dead())
             {
                 return unit;
@@ -376,30 +585,239 @@ public:
         }
         return nullptr;
     }
+    IUnitInternal* FindUnitToAttack(const Coord& center, uint32_t radius_from, uint32_t radius_to) override
+    {
+        auto* profiler = logger_.Profiler();
+        const ProfileScope scope(profiler, ProfilePhase::target);
+        const PlannedScan* scan = stepping_ ? stepping_->Match(center, radius_from, radius_to) : nullptr;
+        if(scan && !dirty_.Touches(center, radius_to))
+        {
+            attacked_ = scan->found;
+            return attacked_ == kNoSlot ? nullptr : storage_.At(attacked_);
+        }
+        uint64_t cells = 0;
+        const auto found = ScanUnitToAttack(center, radius_from, radius_to, cells);
+        if constexpr (TickProfiler::kEnabled)
+        {
+            if(profiler)
+            {
+                profiler->AddCells(cells);
+            }
+        }
+        attacked_ = found;
+        return attacked_ == kNoSlot ? nullptr : storage_.At(attacked_);
+    }
 private:
-    void AddUnitI(UnitPtr&& unit, const Coord& coord)
+    Coord ExtremeCell() const
+    {
+        return { amap_.width - 1, amap_.height - 1 };
+    }
+    /*! \brief Slot of the first living unit of the ring, see FindUnitToAttack. Reads the field only,
+        so it may run on several threads.
+        \param cells Incremented by the cells looked up when profiling is compiled in.
+    */
+    uint32_t ScanUnitToAttack(const Coord& center, uint32_t radius_from, uint32_t radius_to, uint64_t& cells)
+    {
+        if(scanner_.Prefer(center, ExtremeCell(), radius_to))
+        {
+            const auto slot = scanner_.Find(center, radius_from, radius_to);
+            //Unless another unit has stepped into its cell since, hiding it from the walk of the cells.
+            if(slot == kNoSlot || positions_.Find(scanner_.Cell(slot)) == slot)
+            {
+                return slot;
+            }
+        }
+        uint32_t found = kNoSlot;
+        //Only the strips of the ring holding a living unit are walked.
+        ForEachMarkedAround(bits_, center, ExtremeCell(), radius_from, radius_to, [this, &found, &cells](const Coord& coord)
+        {
+            if constexpr (TickProfiler::kEnabled)
+            {
+                ++cells;
+            }
+            const auto slot = positions_.Find(coord);
+            if(slot == kNoSlot || storage_.At(slot)->Dead())
+            {
+                return false;
+            }
+            found = slot;
+            return true;
+        });
+        return found;
+    }
+    //! \brief First phase of the tick: record the searches of every unit queued, in parallel. See step_plan.h.
+    void PlanSteps()
+    {
+        const auto& ticking = active_.Ticking();
+        plans_.resize(storage_.NextSlot());
+        dirty_.Clear();
+        std::atomic<uint64_t> planned_cells{0};
+        pool_->ForEach(static_cast<uint32_t>(ticking.size()), kPlanChunk, [this, &ticking, &planned_cells](uint32_t begin, uint32_t end)
+        {
+            uint64_t cells = 0;
+            for(auto index = begin; index < end; ++index)
+            {
+                const auto slot = ticking[index];
+                auto& plan = plans_[slot];
+                plan.count = 0;
+                storage_.Visit(slot, [this, &plan, &cells](const auto& unit)
+                {
+                    unit.PlanStep([this, &plan, &cells](const Coord& center, uint32_t radius_from, uint32_t radius_to)
+                    {
+                        PlannedScan scan;
+                        scan.center = center;
+                        scan.radius_from = radius_from;
+                        scan.radius_to = radius_to;
+                        scan.found = ScanUnitToAttack(center, radius_from, radius_to, cells);
+                        plan.Add(scan);
+                        return scan.found != kNoSlot;
+                    });
+                });
+            }
+            if constexpr (TickProfiler::kEnabled)
+            {
+                planned_cells.fetch_add(cells, std::memory_order_relaxed);
+            }
+        });
+        if constexpr (TickProfiler::kEnabled)
+        {
+            if(auto* profiler = logger_.Profiler())
+            {
+                profiler->AddCells(planned_cells.load());
+            }
+        }
+    }
+    //! \brief Recreate the units and the occupancy index of the snapshot. Every unit steps on the next tick.
+    void Restore(const SnapshotReader& snapshot)
+    {
+        const auto& header = snapshot.Header();
+        for(uint32_t slot = 0; slot < header.units; ++slot)
+        {
+            const auto record = snapshot.Unit(slot);
+            WithSpawnCommand(record, [this](const auto& command)
+            {
+                storage_.StoreUnit(this, &logger_, command, idle_units_);
+            });
+            storage_.Visit(slot, [&record](auto& unit) { unit.Restore(record); });
+            active_.Add(slot);
+        }
+        for(uint64_t index = 0; index < header.cells; ++index)
+        {
+            const auto cell = snapshot.Cell(index);
+            const Coord coord(cell.x, cell.y);
+            Expected(storage_.Visit(cell.slot, [](const auto& unit) { return unit.CurrentPosition(); }) == coord,
+                "Snapshot: unit out of its cell");
+            Expected(positions_.Find(coord) == kNoSlot, "Snapshot: two units in a cell");
+            positions_.Occupy(coord, cell.slot);
+        }
+        for(uint32_t slot = 0; slot < header.units; ++slot)
+        {
+            TrackUnit(slot);
+        }
+        logger_.SetTick(header.tick);
+    }
+    /*! \brief Update the packed position of the unit, the bit of its cell and its term in the state hash after it changed.
+        Every occupied cell holds the unit standing there, so tracking the units keeps every bit up to date.
+    */
+    void TrackUnit(uint32_t slot)
+    {
+        storage_.Visit(slot, [this, slot](const auto& unit)
+        {
+            const auto cell = unit.CurrentPosition();
+            scanner_.Set(slot, cell, !unit.Dead());
+            const auto standing = positions_.Find(cell);
+            bits_.Set(cell, standing != kNoSlot && !storage_.At(standing)->Dead());
+            if(hash_)
+            {
+                hash_->Set(slot, unit.Id(), unit.Hp(), cell);
+            }
+        });
+    }
+    template<typename TCommandData>
+    void AddUnitI(const TCommandData& data)
     {
+        const Coord coord(data.x, data.y);
         CheckRt(coord.x < amap_.width, "X coordinate: out of range");
         CheckRt(coord.y < amap_.height, "Y coordinate: out of range");
         
-        auto iter = positions_.find(coord);
-        CheckRt(iter == positions_.cend(), "Could not place unit into the cell specified");
-        positions_[coord] = unit->Id();
+        CheckRt(positions_.Find(coord) == kNoSlot, "Could not place unit into the cell specified");
+        const auto slot = storage_.NextSlot();
+        positions_.Occupy(coord, slot);
 
-        storage_.StoreUnit(std::move(unit));
+        storage_.StoreUnit(this, &logger_, data, idle_units_);
+        TrackUnit(slot);
+        active_.Add(slot);
+        active_.Touch(coord, true);
+        logger_.Log(io::UnitSpawned{ data.unitId, data.Name, data.x, data.y});
     }
 private:
     io::CreateMap amap_;
+    Logger& logger_;
     UnitStorage storage_;
-    std::map<Coord, uint32_t> positions_;
+    //Slots of the units by their cells.
+    TOccupancy positions_;
+    //Cells holding a living unit, see occupancy_bits.h.
+    OccupancyBits bits_;
+    RingOffsetCache rings_;
+    //Units to step, see active_set.h.
+    ActiveSet active_;
+    //See BattleFieldOptions::idle_units.
+    bool idle_units_;
+    //Positions of the units for the searches of long ranges, see unit_scan.h.
+    UnitScanner scanner_;
+
+    //Two-phase tick, see step_plan.h.
+    static constexpr uint32_t kPlanChunk = 256;
+    std::unique_ptr<TaskPool> pool_;
+    std::vector<StepPlan> plans_;
+    DirtyTiles dirty_;
+    //Plan of the unit stepping now, nullptr if its searches are not planned.
+    const StepPlan* stepping_ = nullptr;
+    //Slot of the unit found by the last search of the unit stepping now, kNoSlot if none.
+    uint32_t attacked_ = kNoSlot;
+
+    //Hash of the state, nullptr unless BattleFieldOptions::state_hash.
+    std::unique_ptr<RollingStateHash> hash_;
 };
 
-std::unique_ptr<IBattleField> CreateBattleField(const io::CreateMap& createmap)
+std::unique_ptr<IBattleField> CreateBattleField(const io::CreateMap& createmap, Logger& logger, const BattleFieldOptions& options)
 {
-    std::unique_ptr<IBattleField> ptr;
     CheckRt(createmap.height && createmap.width, "Incorrect width or height");
-    ptr.reset(new BattleField(createmap));
-    return ptr;
+    if(options.engine == BattleFieldOptions::soa)
+    {
+        return CreateSoaBattleField(createmap, logger, options);
+    }
+    const auto layout = ChooseOccupancyLayout(createmap.width, createmap.height, options.expected_units);
+    return WithOccupancy(layout, [&createmap, &logger, &options](auto tag)
+    {
+        std::unique_ptr<IBattleField> ptr;
+        ptr.reset(new BattleField<typename decltype(tag)::type>(createmap, logger, options, nullptr));
+        return ptr;
+    });
+}
+
+std::unique_ptr<IBattleField> RestoreBattleField(std::string_view data, Logger& logger, const BattleFieldOptions& options)
+{
+    const SnapshotReader snapshot(data);
+    const auto createmap = snapshot.Map();
+    CheckRt(createmap.height && createmap.width, "Incorrect width or height");
+    if(options.engine == BattleFieldOptions::soa)
+    {
+        return CreateSoaBattleField(createmap, logger, options, &snapshot);
+    }
+    const auto layout = ChooseOccupancyLayout(createmap.width, createmap.height, snapshot.Header().units);
+    return WithOccupancy(layout, [&createmap, &logger, &options, &snapshot](auto tag)
+    {
+        std::unique_ptr<IBattleField> ptr;
+        ptr.reset(new BattleField<typename decltype(tag)::type>(createmap, logger, options, &snapshot));
+        return ptr;
+    });
+}
+
+uint64_t OccupancyMemory(const io::CreateMap& createmap, uint64_t units)
+{
+    const auto layout = ChooseOccupancyLayout(createmap.width, createmap.height, units);
+    return EstimateOccupancyMemory(layout, createmap.width, createmap.height);
 }
 
 }//namespace sw
\ No newline at end of file
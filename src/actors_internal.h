@@ -57,8 +57,6 @@ public:
     virtual bool IfAttackHarmful(const Attack& attack) const = 0;
 };
 
-using UnitPtr = std::unique_ptr<IUnitInternal>;
-
 //! \brief Internal interface used by actors within the battle.
 class IBattleFieldInternal
 {
@@ -71,8 +69,16 @@ public:
     */
     virtual IUnitInternal* GetUnitToAttack(const std::vector<Coord>& coords) = 0;
 
-    //! \brief Get path between two cells, Besenham's algorithm.
-    virtual std::vector<Coord> AcquirePath(const Coord& from, const Coord& target) = 0;
+    /*! \brief Get a unit to attack around the cell, without materializing the cells.
+        \param center center cell.
+        \param radius_from
+        \param radius_to
+        \return First living unit in the order of AcquireCoordinatesAround. NULL if no units found.
+    */
+    virtual IUnitInternal* FindUnitToAttack(const Coord& center, uint32_t radius_from, uint32_t radius_to) = 0;
+
+    //! \brief Get path between two cells, Besenham's algorithm. The cells are produced as the unit walks.
+    virtual PathCursor AcquirePath(const Coord& from, const Coord& target) = 0;
 
     /*! \brief Get cells around.
         \param center center cell.
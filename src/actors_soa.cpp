@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <vector>
+
+#include <IO/Commands/SpawnWarrior.hpp>
+#include <IO/Commands/SpawnArcher.hpp>
+#include <IO/Commands/March.hpp>
+
+#include <IO/Events/MapCreated.hpp>
+#include <IO/Events/UnitSpawned.hpp>
+#include <IO/Events/MarchStarted.hpp>
+#include <IO/Events/UnitDied.hpp>
+#include <IO/Events/UnitAttacked.hpp>
+#include <IO/Events/UnitMoved.hpp>
+#include <IO/Events/MarchEnded.hpp>
+
+#include "actors_soa.h"
+#include "occupancy.h"
+#include "occupancy_bits.h"
+#include "id_index.h"
+#include "active_set.h"
+#include "snapshot.h"
+#include "state_hash.h"
+#include "unit_scan.h"
+
+namespace sw
+{
+
+/*
+    Units are kept as structure of arrays indexed by slot, the order units were spawned in.
+    Stats specific for a kind live in arrays of that kind, indexed by kind_index_.
+    A tick walks the active units in slot order, see active_set.h, and switches on the kind: units act one after another,
+    each seeing what the previous ones did, exactly as the virtual units do.
+*/
+
+//! \brief Stats of warriors.
+struct SoaWarriors
+{
+    std::vector<uint32_t> strength;
+};
+
+//! \brief Stats of archers.
+struct SoaArchers
+{
+    std::vector<uint32_t> strength;
+    std::vector<uint32_t> agility;
+    std::vector<uint32_t> range;
+};
+
+template<typename TOccupancy>
+class SoaBattleField : public IBattleField
+{
+public:
+    //! \param snapshot Snapshot to restore the battle from, nullptr for a new battle.
+    SoaBattleField(const io::CreateMap& amap, Logger& logger, const BattleFieldOptions& options, const SnapshotReader* snapshot)
+        :   amap_(amap)
+        ,   logger_(logger)
+        ,   positions_(amap.width, amap.height)
+        ,   bits_(amap.width, amap.height)
+        ,   idle_units_(options.idle_units)
+    {
+        CheckRt(amap_.height && amap_.width, "Invalid arguments: height or width is zero");
+        if(options.state_hash)
+        {
+            hash_ = std::make_unique<RollingStateHash>();
+        }
+        if(auto* profiler = logger_.Profiler())
+        {
+            //Same order as kind_t.
+            profiler->SetKinds({ io::SpawnWarrior::Name, io::SpawnArcher::Name });
+        }
+        if(snapshot)
+        {
+            Restore(*snapshot);
+            return;
+        }
+        logger_.Log(io::MapCreated{amap_.width, amap_.height});
+    }
+    //IBattleField
+    void AddUnit(const io::SpawnWarrior& warrior) override
+    {
+        PlaceUnit({ warrior.x, warrior.y });
+        StoreUnit(warrior);
+        logger_.Log(io::UnitSpawned{ warrior.unitId, warrior.Name, warrior.x, warrior.y});
+    }
+    void AddUnit(const io::SpawnArcher& archer) override
+    {
+        PlaceUnit({ archer.x, archer.y });
+        StoreUnit(archer);
+        logger_.Log(io::UnitSpawned{ archer.unitId, archer.Name, archer.x, archer.y});
+    }
+    void MarchTo(const io::March& march) override
+    {
+        const auto slot = index_.Find(march.unitId);
+        CheckFatal(slot != kNoSlot);
+        const Coord target(march.targetX, march.targetY);
+        paths_[slot] = PathCursor(spawns_[slot], target);
+        march_ended_[slot] = false;
+        logger_.Log(io::MarchStarted { ids_[slot], spawns_[slot].x, spawns_[slot].y, target.x, target.y });
+        active_.Wake(slot);
+    }
+    bool DoNextStep() override
+    {
+        auto* profiler = logger_.Profiler();
+        const TickProfileScope tick_scope(profiler, logger_.Tick());
+        int further(0);
+        active_.BeginTick();
+        bool queued(false);
+        for(auto slot = active_.Next(queued); slot != kNoSlot; slot = active_.Next(queued))
+        {
+            const ProfileScope unit_scope(profiler, ProfilePhase::movement, kinds_[slot]);
+            const auto current_pos = Position(slot);
+            {
+                const ProfileScope scope(profiler, ProfilePhase::occupancy);
+                positions_.Vacate(current_pos);
+            }
+
+            bool further_step(false);
+            const auto new_pos = kinds_[slot] == kind_warrior
+                ? WarriorStep(slot, further_step)
+                : ArcherStep(slot, further_step);
+            further += static_cast<int>(further_step);
+            {
+                const ProfileScope scope(profiler, ProfilePhase::occupancy);
+                positions_.Occupy(new_pos, slot);
+                if(!(new_pos == current_pos))
+                {
+                    active_.Touch(current_pos, false);
+                    bits_.Set(current_pos, false);
+                }
+                active_.Touch(new_pos, hp_[slot] != 0);
+            }
+            TrackUnit(slot);
+            if(further_step || !(idle_units_ || !hp_[slot]))
+            {
+                //Unless units may idle, a living unit logs the end of its march again on its next step.
+                active_.Wake(slot);
+            }
+            else
+            {
+                active_.Watch(slot, new_pos, hp_[slot] ? WatchRadius(slot) : 0);
+            }
+        }
+        return (further > 1);
+    }
+    void Checkpoint(std::string& out) const override
+    {
+        const auto count = static_cast<uint32_t>(ids_.size());
+        SnapshotWriter writer(out, amap_, logger_.Tick(), count);
+        for(uint32_t slot = 0; slot < count; ++slot)
+        {
+            const auto kind_index = kind_index_[slot];
+            SnapshotUnit unit;
+            if(kinds_[slot] == kind_warrior)
+            {
+                unit.kind = SnapshotUnit::warrior;
+                unit.strength = warriors_.strength[kind_index];
+            }
+            else
+            {
+                unit.kind = SnapshotUnit::archer;
+                unit.strength = archers_.strength[kind_index];
+                unit.agility = archers_.agility[kind_index];
+                unit.range = archers_.range[kind_index];
+            }
+            unit.id = ids_[slot];
+            unit.x = spawns_[slot].x;
+            unit.y = spawns_[slot].y;
+            unit.hp = hp_[slot];
+            unit.path = paths_[slot].Save();
+            unit.march_ended = march_ended_[slot];
+            writer.Add(unit);
+        }
+        //Every occupied cell holds the unit standing there, so the units give the cells without a walk of the map.
+        for(uint32_t slot = 0; slot < count; ++slot)
+        {
+            const auto cell = Position(slot);
+            if(positions_.Find(cell) == slot)
+            {
+                writer.Add(cell, slot);
+            }
+        }
+        writer.Finish();
+    }
+    uint64_t StateHash() const override
+    {
+        return hash_ ? hash_->Value() : 0;
+    }
+    BattleFieldDiagnostics Diagnostics() const override
+    {
+        BattleFieldDiagnostics diagnostics;
+        diagnostics.occupancy = OccupancyLayoutName(TOccupancy::kLayout);
+        diagnostics.occupancy_memory = positions_.MemoryUsage() + bits_.MemoryUsage();
+        diagnostics.units = static_cast<uint32_t>(ids_.size());
+        return diagnostics;
+    }
+private:
+    enum kind_t : uint8_t
+    {
+        kind_warrior,
+        kind_archer
+    };
+
+    //! \brief Put the unit about to be stored into its spawn cell.
+    void PlaceUnit(const Coord& coord)
+    {
+        CheckRt(coord.x < amap_.width, "X coordinate: out of range");
+        CheckRt(coord.y < amap_.height, "Y coordinate: out of range");
+        CheckRt(positions_.Find(coord) == kNoSlot, "Could not place unit into the cell specified");
+
+        positions_.Occupy(coord, static_cast<uint32_t>(ids_.size()));
+        active_.Touch(coord, true);
+    }
+    void StoreUnit(const io::SpawnWarrior& warrior)
+    {
+        StoreUnitI(warrior.unitId, warrior.hp, kind_warrior, warriors_.strength.size(), { warrior.x, warrior.y });
+        warriors_.strength.push_back(warrior.strength);
+    }
+    void StoreUnit(const io::SpawnArcher& archer)
+    {
+        StoreUnitI(archer.unitId, archer.hp, kind_archer, archers_.range.size(), { archer.x, archer.y });
+        archers_.strength.push_back(archer.strength);
+        archers_.agility.push_back(archer.agility);
+        archers_.range.push_back(archer.range);
+    }
+    void StoreUnitI(uint32_t id, uint32_t hp, kind_t kind, size_t kind_index, const Coord& coord)
+    {
+        const auto slot = static_cast<uint32_t>(ids_.size());
+        CheckRt(index_.Insert(id, slot), "Unit already created");
+        active_.Add(slot);
+
+        ids_.push_back(id);
+        hp_.push_back(hp);
+        kinds_.push_back(kind);
+        kind_index_.push_back(static_cast<uint32_t>(kind_index));
+        spawns_.push_back(coord);
+        paths_.emplace_back();
+        march_ended_.push_back(false);
+        TrackUnit(slot);
+    }
+    /*! \brief Update the packed position of the unit, the bit of its cell and its term in the state hash after it changed.
+        Every occupied cell holds the unit standing there, so tracking the units keeps every bit up to date.
+    */
+    void TrackUnit(uint32_t slot)
+    {
+        const auto cell = Position(slot);
+        scanner_.Set(slot, cell, hp_[slot] != 0);
+        const auto standing = positions_.Find(cell);
+        bits_.Set(cell, standing != kNoSlot && hp_[standing] != 0);
+        if(hash_)
+        {
+            hash_->Set(slot, ids_[slot], hp_[slot], cell);
+        }
+    }
+    //! \brief Recreate the units and the occupancy index of the snapshot. Every unit steps on the next tick.
+    void Restore(const SnapshotReader& snapshot)
+    {
+        const auto& header = snapshot.Header();
+        for(uint32_t slot = 0; slot < header.units; ++slot)
+        {
+            const auto record = snapshot.Unit(slot);
+            WithSpawnCommand(record, [this](const auto& command)
+            {
+                StoreUnit(command);
+            });
+            paths_[slot] = PathCursor(record.path);
+            march_ended_[slot] = record.march_ended != 0;
+        }
+        for(uint64_t index = 0; index < header.cells; ++index)
+        {
+            const auto cell = snapshot.Cell(index);
+            const Coord coord(cell.x, cell.y);
+            Expected(Position(cell.slot) == coord, "Snapshot: unit out of its cell");
+            Expected(positions_.Find(coord) == kNoSlot, "Snapshot: two units in a cell");
+            positions_.Occupy(coord, cell.slot);
+        }
+        for(uint32_t slot = 0; slot < header.units; ++slot)
+        {
+            TrackUnit(slot);
+        }
+        logger_.SetTick(header.tick);
+    }
+    Coord ExtremeCell() const
+    {
+        return { amap_.width - 1, amap_.height - 1 };
+    }
+    Coord Position(uint32_t slot) const
+    {
+        const auto& path = paths_[slot];
+        return path.Empty() ? spawns_[slot] : path.Current();
+    }
+    //! \brief Slot of the first living unit around the cell. kNoSlot if none.
+    uint32_t FindUnitToAttack(const Coord& center, uint32_t radius_from, uint32_t radius_to)
+    {
+        auto* profiler = logger_.Profiler();
+        const ProfileScope scope(profiler, ProfilePhase::target);
+        if(scanner_.Prefer(center, ExtremeCell(), radius_to))
+        {
+            const auto slot = scanner_.Find(center, radius_from, radius_to);
+            //Unless another unit has stepped into its cell since, hiding it from the walk of the cells.
+            if(slot == kNoSlot || positions_.Find(scanner_.Cell(slot)) == slot)
+            {
+                return slot;
+            }
+        }
+        uint32_t found = kNoSlot;
+        uint64_t cells = 0;
+        //Only the strips of the ring holding a living unit are walked.
+        ForEachMarkedAround(bits_, center, ExtremeCell(), radius_from, radius_to, [this, &found, &cells](const Coord& coord)
+        {
+            if constexpr (TickProfiler::kEnabled)
+            {
+                ++cells;
+            }
+            const auto slot = positions_.Find(coord);
+            if(slot == kNoSlot || !hp_[slot])
+            {
+                return false;
+            }
+            found = slot;
+            return true;
+        });
+        if constexpr (TickProfiler::kEnabled)
+        {
+            if(profiler)
+            {
+                profiler->AddCells(cells);
+            }
+        }
+        return found;
+    }
+    void DoAttack(uint32_t attacker, uint32_t target, uint32_t damage)
+    {
+        auto& hp = hp_[target];
+        hp = (damage > hp) ? 0 : hp - damage;
+        TrackUnit(target);
+        logger_.Log(io::UnitAttacked{ids_[attacker], ids_[target], damage, hp });
+        if(!hp)
+        {
+            logger_.Log(io::UnitDied{ ids_[target] });
+        }
+    }
+    //! \brief Try to attack a unit around. \return true if attacked.
+    bool AttackAround(uint32_t slot, const Coord& my_pos, uint32_t radius_from, uint32_t radius_to, uint32_t damage)
+    {
+        const auto target = FindUnitToAttack(my_pos, radius_from, radius_to);
+        if(target == kNoSlot)
+        {
+            return false;
+        }
+        DoAttack(slot, target, damage);
+        return true;
+    }
+    //! \brief A unit must have been given a march before it steps, unless units may idle.
+    void CheckMarch(uint32_t slot) const
+    {
+        CheckFatal(idle_units_ || !paths_[slot].Empty());
+    }
+    //! \brief Distance of the farthest cell the unit looks for a unit to attack.
+    uint32_t WatchRadius(uint32_t slot) const
+    {
+        return kinds_[slot] == kind_warrior ? 1 : std::max<uint32_t>(1, archers_.range[kind_index_[slot]]);
+    }
+    //! \brief Move along the path when there is nothing to attack. The end of the march is logged as in UnitImpl::MarchStep.
+    Coord MarchStep(uint32_t slot, bool& further)
+    {
+        auto& path = paths_[slot];
+        const auto my_pos = Position(slot);
+        if(path.Empty() || path.AtEnd())
+        {
+            further = false;
+            if(!path.Empty() && !(idle_units_ && march_ended_[slot]))
+            {
+                march_ended_[slot] = true;
+                logger_.Log(io::MarchEnded{ids_[slot], my_pos.x, my_pos.y});
+            }
+            return my_pos;
+        }
+        path.Advance();
+        const auto next_pos = path.Current();
+        logger_.Log(io::UnitMoved{ids_[slot], next_pos.x, next_pos.y});
+        further = true;
+        return next_pos;
+    }
+    Coord WarriorStep(uint32_t slot, bool& further)
+    {
+        CheckMarch(slot);
+        const auto my_pos = Position(slot);
+        if(!hp_[slot])
+        {
+            further = false;
+            return my_pos;
+        }
+        const auto kind_index = kind_index_[slot];
+        if(AttackAround(slot, my_pos, 1, 1, warriors_.strength[kind_index]))
+        {
+            further = true;
+            return my_pos;
+        }
+        return MarchStep(slot, further);
+    }
+    Coord ArcherStep(uint32_t slot, bool& further)
+    {
+        CheckMarch(slot);
+        const auto my_pos = Position(slot);
+        if(!hp_[slot])
+        {
+            further = false;
+            return my_pos;
+        }
+        const auto kind_index = kind_index_[slot];
+        if(AttackAround(slot, my_pos, 1, 1, archers_.strength[kind_index]) ||
+           AttackAround(slot, my_pos, 2, archers_.range[kind_index], archers_.agility[kind_index]))
+        {
+            further = true;
+            return my_pos;
+        }
+        return MarchStep(slot, further);
+    }
+private:
+    io::CreateMap amap_;
+    Logger& logger_;
+    //Common data of units, by slot.
+    std::vector<uint32_t> ids_;
+    std::vector<uint32_t> hp_;
+    std::vector<kind_t> kinds_;
+    std::vector<uint32_t> kind_index_;
+    std::vector<Coord> spawns_;
+    std::vector<PathCursor> paths_;
+    std::vector<bool> march_ended_;
+    //Data specific for kinds, by kind_index_.
+    SoaWarriors warriors_;
+    SoaArchers archers_;
+
+    IdIndex index_;
+    TOccupancy positions_;
+    //Cells holding a living unit, see occupancy_bits.h.
+    OccupancyBits bits_;
+    //Units to step, see active_set.h.
+    ActiveSet active_;
+    //See BattleFieldOptions::idle_units.
+    bool idle_units_;
+    //Positions of the units for the searches of long ranges, see unit_scan.h.
+    UnitScanner scanner_;
+    //Hash of the state, nullptr unless BattleFieldOptions::state_hash.
+    std::unique_ptr<RollingStateHash> hash_;
+};
+
+std::unique_ptr<IBattleField> CreateSoaBattleField(const io::CreateMap& createmap, Logger& logger, const BattleFieldOptions& options, const SnapshotReader* snapshot)
+{
+    const uint64_t units = snapshot ? snapshot->Header().units : options.expected_units;
+    return WithOccupancy(ChooseOccupancyLayout(createmap.width, createmap.height, units), [&createmap, &logger, &options, snapshot](auto tag)
+    {
+        std::unique_ptr<IBattleField> ptr;
+        ptr.reset(new SoaBattleField<typename decltype(tag)::type>(createmap, logger, options, snapshot));
+        return ptr;
+    });
+}
+
+}//namespace sw
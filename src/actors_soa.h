@@ -0,0 +1,21 @@
+#ifndef __ACTORS_SOA_H__
+#define __ACTORS_SOA_H__
+#include <memory>
+#include "actors.h"
+
+namespace sw
+{
+
+class SnapshotReader;
+
+/*! \brief Create a battle field keeping units as structure of arrays.
+    \param logger Logger of the battle, must outlive the battle field.
+    \param options Settings of the battle field, the engine and the threads are ignored.
+    \param snapshot Snapshot to restore the battle from, nullptr for a new battle. See RestoreBattleField.
+    \return IBattleField pointer producing the same events as the battle field of virtual units.
+*/
+std::unique_ptr<IBattleField> CreateSoaBattleField(const io::CreateMap&, Logger& logger, const BattleFieldOptions& options = {}, const SnapshotReader* snapshot = nullptr);
+
+}//namespace sw
+
+#endif /*__ACTORS_SOA_H__*/
@@ -0,0 +1,188 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <thread>
+#include <algorithm>
+
+#include "batch.h"
+#include "simulation.h"
+
+namespace sw
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//! \brief Output file of every scenario, unique even if command files of different directories share a name.
+std::vector<std::string> OutputFiles(const BatchOptions& options)
+{
+    const char* extension = options.log.target == EventSinkOptions::Target::binaryFile ? ".bin" : ".log";
+    std::vector<std::string> outputs;
+    std::set<std::string> taken;
+    outputs.reserve(options.scenarios.size());
+    for(const auto& scenario : options.scenarios)
+    {
+        const auto stem = std::filesystem::path(scenario).filename().string();
+        auto name = stem + extension;
+        for(uint32_t copy = 1; !taken.insert(name).second; ++copy)
+        {
+            name = stem + "-" + std::to_string(copy) + extension;
+        }
+        outputs.push_back((std::filesystem::path(options.output_dir) / name).string());
+    }
+    return outputs;
+}
+
+ScenarioResult RunScenario(const BatchOptions& options, const std::string& scenario, const std::string& output)
+{
+    ScenarioResult result;
+    result.scenario = scenario;
+    const auto start = Clock::now();
+    try
+    {
+        auto log = options.log;
+        if(log.target != EventSinkOptions::Target::none)
+        {
+            if(log.target == EventSinkOptions::Target::standardOutput)
+            {
+                log.target = EventSinkOptions::Target::textFile;
+            }
+            log.path = output;
+            result.output = output;
+        }
+        SimulatingMachine machine(options.field, createEventSink(log));
+        try
+        {
+            machine.Run(scenario.c_str());
+        }
+        catch (...)
+        {
+            result.ticks = machine.Ticks();
+            throw;
+        }
+        result.ticks = machine.Ticks();
+        result.ok = true;
+    }
+    catch (const std::exception& e)
+    {
+        result.error = e.what();
+    }
+    catch (...)
+    {
+        result.error = "Unknown error";
+    }
+    result.seconds = SecondsSince(start);
+    return result;
+}
+
+}//namespace
+
+std::vector<std::string> ListScenarios(const std::string& path)
+{
+    std::vector<std::string> scenarios;
+    if(std::filesystem::is_directory(path))
+    {
+        for(const auto& entry : std::filesystem::directory_iterator(path))
+        {
+            if(entry.is_regular_file())
+            {
+                scenarios.push_back(entry.path().string());
+            }
+        }
+        std::sort(scenarios.begin(), scenarios.end());
+        return scenarios;
+    }
+    std::ifstream list(path);
+    Expected(!!list, "Scenario list not found");
+    for(std::string line; std::getline(list, line);)
+    {
+        if(!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if(!line.empty())
+        {
+            scenarios.push_back(line);
+        }
+    }
+    return scenarios;
+}
+
+BatchSummary RunBatch(const BatchOptions& options)
+{
+    BatchSummary summary;
+    summary.results.resize(options.scenarios.size());
+    if(options.log.target != EventSinkOptions::Target::none)
+    {
+        std::filesystem::create_directories(options.output_dir);
+    }
+    const auto outputs = OutputFiles(options);
+
+    auto jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = static_cast<unsigned>(std::min<size_t>(jobs, std::max<size_t>(1, options.scenarios.size())));
+
+    const auto start = Clock::now();
+    std::atomic<size_t> next{0};
+    auto worker = [&]()
+    {
+        for(auto index = next++; index < options.scenarios.size(); index = next++)
+        {
+            summary.results[index] = RunScenario(options, options.scenarios[index], outputs[index]);
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(jobs);
+    for(unsigned i = 0; i < jobs; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+    for(auto& thread : pool)
+    {
+        thread.join();
+    }
+    summary.seconds = SecondsSince(start);
+
+    for(const auto& result : summary.results)
+    {
+        summary.ticks += result.ticks;
+        summary.failed += !result.ok;
+    }
+    return summary;
+}
+
+void PrintSummary(std::ostream& out, const BatchSummary& summary)
+{
+    const auto flags = out.flags();
+    out << std::fixed << std::setprecision(6);
+    for(const auto& result : summary.results)
+    {
+        out << (result.ok ? "OK   " : "FAIL ") << result.scenario
+            << " ticks=" << result.ticks
+            << " seconds=" << result.seconds;
+        if(!result.ok)
+        {
+            out << " error=" << result.error;
+        }
+        out << '\n';
+    }
+    const auto count = summary.results.size();
+    out << "Scenarios: " << count
+        << ", failed: " << summary.failed
+        << ", ticks: " << summary.ticks
+        << ", seconds: " << summary.seconds
+        << ", scenarios/sec: " << std::setprecision(2) << (summary.seconds > 0 ? count / summary.seconds : 0.0)
+        << std::endl;
+    out.flags(flags);
+}
+
+}//namespace sw
@@ -0,0 +1,65 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+#include <ostream>
+#include <string>
+#include <vector>
+#include <IO/System/EventSink.hpp>
+#include "actors.h"
+
+namespace sw
+{
+
+//! \brief Settings of a batch of battles.
+struct BatchOptions
+{
+    //! \brief Command files, one battle each.
+    std::vector<std::string> scenarios;
+    //! \brief Directory the event log of every battle is written to, named after its command file.
+    std::string output_dir = "sw_batch";
+    //! \brief Battles simulated at once. 0 means one per hardware thread.
+    unsigned jobs = 0;
+    BattleFieldOptions field;
+    /*! \brief Events logged by every battle. Text goes to OUTPUT_DIR/NAME.log, binary logs to OUTPUT_DIR/NAME.bin;
+        the path of the options is not used.
+    */
+    EventSinkOptions log;
+};
+
+//! \brief Result of one battle of a batch.
+struct ScenarioResult
+{
+    std::string scenario;
+    std::string output;
+    bool ok = false;
+    //! \brief What failed the battle if not ok.
+    std::string error;
+    uint64_t ticks = 0;
+    double seconds = 0;
+};
+
+//! \brief Results of a batch, in the order of BatchOptions::scenarios.
+struct BatchSummary
+{
+    std::vector<ScenarioResult> results;
+    uint64_t ticks = 0;
+    uint32_t failed = 0;
+    double seconds = 0;
+};
+
+/*! \brief Command files of a batch.
+    \param path A directory, all its regular files are taken in name order, or a file listing one command file per line.
+    \exception std::runtime_error if the path can not be read.
+*/
+std::vector<std::string> ListScenarios(const std::string& path);
+
+/*! \brief Simulate the battles on a fixed pool of threads.
+    A failing battle is reported in its result and does not stop the others.
+*/
+BatchSummary RunBatch(const BatchOptions& options);
+
+//! \brief Print a line per battle and the totals: battles per second, ticks, wall time.
+void PrintSummary(std::ostream& out, const BatchSummary& summary);
+
+}//namespace sw
+
+#endif /*__BATCH_H__*/
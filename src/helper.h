@@ -1,7 +1,10 @@
 #ifndef __HELPER_H__
 #define __HELPER_H__
+#include <algorithm>
+#include <cassert>
 #include <cstdint>
 #include <stdexcept>
+#include <utility>
 
 namespace sw
 {
@@ -29,15 +32,8 @@ inline void CheckFatal(bool condition)
     }
 }
 
-struct Cell
-{
-    int64_t x = 0;
-    int64_t y = 0;
-};
-inline bool operator<(const Cell& lv, const Cell& rv)
-{
-    return lv.x == rv.x ? lv.y < rv.y : lv.x < rv.x;
-}
+//! \brief Absent slot of a unit: a free cell, an unknown id.
+constexpr uint32_t kNoSlot = ~uint32_t();
 
 struct Coord
 {
@@ -73,123 +69,151 @@ inline bool operator!=(const Coord& lv, const Coord& rv)
     return !(lv == rv);
 }
 
-inline std::set<Cell> GetCellsOfLevels(int64_t level_from, int64_t level_to)
+/*! \brief Lazy path between two cells: visits the cells of Bresenham's line one at a time.
+    Keeps the error term of the algorithm only, so a march costs the same memory whatever its length.
+    A cursor is consistent once constructed, so the accessors called on every step only assert their preconditions.
+*/
+class PathCursor
 {
-    if(level_from > level_to)
+public:
+    //! \brief No path, e.g. the unit has never marched.
+    PathCursor()
+        :   x_(0)
+        ,   y_(0)
+        ,   end_x_(0)
+        ,   end_y_(0)
+        ,   dx_(0)
+        ,   dy_(0)
+        ,   err_(0)
+        ,   sx_(0)
+        ,   sy_(0)
+        ,   valid_(false)
+        ,   remaining_(0)
     {
-        return {};
+        ;
     }
-    std::set<Cell> cells;
-    for(auto level = level_from; level <= level_to; ++level)
-    {
-        for(int64_t x = 0; x <= level; ++x)
-        {
-            cells.emplace(x, level);
-        }
-        for(int64_t y = 0; y <= level; ++y)
-        {
-            cells.emplace(level, y);
-        }
+    PathCursor(const Coord& start, const Coord& end)
+        :   x_(start.x)
+        ,   y_(start.y)
+        ,   end_x_(end.x)
+        ,   end_y_(end.y)
+        ,   dx_(start.x < end.x ? end.x - start.x : start.x - end.x)
+        ,   dy_(start.y < end.y ? end.y - start.y : start.y - end.y)
+        ,   err_(static_cast<int64_t>(dx_) - static_cast<int64_t>(dy_))
+        ,   sx_(start.x < end.x ? 1 : -1)
+        ,   sy_(start.y < end.y ? 1 : -1)
+        ,   valid_(true)
+        ,   remaining_(std::max(dx_, dy_))
+    {
+        ;
     }
-    const std::vector<Cell> quarters
+    //! \brief Fields of a cursor as fixed-width integers without padding, e.g. for a snapshot.
+    struct State
     {
-        {-1, 1},
-        {1, -1},
-        {-1, -1}
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t end_x = 0;
+        uint32_t end_y = 0;
+        uint32_t dx = 0;
+        uint32_t dy = 0;
+        int64_t err = 0;
+        int32_t sx = 0;
+        int32_t sy = 0;
+        uint32_t valid = 0;
+        uint32_t reserved = 0;
     };
-    for(const auto& quarter : quarters)
-    {
-        std::set<Cell> aux;
-        std::transform(cells.cbegin(), cells.cend(), std::inserter(aux, aux.end()), [&quarter](const auto& cell)
-        {
-            return Cell(cell.x * quarter.x, cell.y * quarter.y);
-        });
-        std::copy(aux.cbegin(), aux.cend(), std::inserter(cells, cells.end()));
+    /*! \brief Cursor saved by Save().
+        \exception std::runtime_error if the state is not one of a cursor.
+    */
+    explicit PathCursor(const State& state)
+        :   x_(state.x)
+        ,   y_(state.y)
+        ,   end_x_(state.end_x)
+        ,   end_y_(state.end_y)
+        ,   dx_(state.dx)
+        ,   dy_(state.dy)
+        ,   err_(state.err)
+        ,   sx_(static_cast<int8_t>(state.sx))
+        ,   sy_(static_cast<int8_t>(state.sy))
+        ,   valid_(state.valid != 0)
+        ,   remaining_(std::max(Distance(x_, end_x_), Distance(y_, end_y_)))
+    {
+        Expected(state.valid <= 1, "Bad path");
+        //Both coordinates go towards the target and the error term stays within the bounds the algorithm keeps it in.
+        Expected(!valid_ || (
+            (state.sx == 1 || state.sx == -1) && (state.sy == 1 || state.sy == -1) &&
+            (x_ == end_x_ || (x_ < end_x_) == (sx_ > 0)) && (y_ == end_y_ || (y_ < end_y_) == (sy_ > 0)) &&
+            err_ >= -2 * static_cast<int64_t>(dy_) && err_ <= 2 * static_cast<int64_t>(dx_)), "Bad path");
     }
-    return cells;
-}
-
-inline std::set<Cell> MoveCells(const std::set<Cell>& cells, const Cell& new_center)
-{
-    std::set<Cell> result;
-    std::transform(cells.cbegin(), cells.cend(), std::inserter(result, result.end()), [&new_center](const auto& cell)
-    {
-        Cell moved;
-        moved.x = cell.x + new_center.x;
-        moved.y = cell.y + new_center.y;
-        return moved;
-    });
-    return result;
-}
-
-inline std::vector<Coord> RemoveCellsOutOfBounds(const std::set<Cell>& cells, const Cell& extreme_point)
-{
-    std::set<Cell> tmp;
-    std::copy_if(cells.cbegin(), cells.cend(), std::inserter(tmp, tmp.end()), [&extreme_point](const auto& cell)
-    {
-        return
-            cell.x >= 0 && cell.x <= extreme_point.x &&
-            cell.y >= 0 && cell.y <= extreme_point.y;
-    });
-    std::vector<Coord> result;
-    std::transform(tmp.cbegin(), tmp.cend(), std::back_inserter(result), [](const auto& cell)
-    {
-        return Coord{ static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y) };
-    });
-    return result;
-}
-
-inline std::vector<Coord> CoordinatesAround(const Coord& center, const Coord& extreme_point, uint32_t radius_from, uint32_t radius_to)
-{
-    const auto cells = GetCellsOfLevels(static_cast<int64_t>(radius_from), static_cast<int64_t>(radius_to));
-    const Cell new_center(static_cast<int64_t>(center.x), static_cast<int64_t>(center.y));
-    const auto cells2 = MoveCells(cells, new_center);
-
-    Cell extreme;
-    extreme.x = extreme_point.x;
-    extreme.y = extreme_point.y;
-    return RemoveCellsOutOfBounds(cells2, extreme);
-}
-
-inline std::vector<Coord> Bresenham(const Coord& start, const Coord& end)
-{
-    std::vector<Cell> tmp;
-
-    int64_t x1 = start.x;
-    int64_t x2 = end.x;
-    int64_t y1 = start.y;
-    int64_t y2 = end.y;
-
-    int64_t dx = abs(x2 - x1);
-    int64_t dy = abs(y2 - y1);
-    int64_t sx = (x1 < x2) ? 1 : -1;
-    int64_t sy = (y1 < y2) ? 1 : -1;
-    int64_t err = dx - dy;
-
-    while (true) {
-        tmp.emplace_back(x1, y1);
-        if (x1 == x2 && y1 == y2)
-        {
-            break;
-        }
-        int64_t err2 = err * 2;
-        if (err2 > -dy) {
-            err -= dy;
-            x1 += sx;
-        }
-        if (err2 < dx) {
-            err += dx;
-            y1 += sy;
-        }
+    State Save() const
+    {
+        State state;
+        state.x = x_;
+        state.y = y_;
+        state.end_x = end_x_;
+        state.end_y = end_y_;
+        state.dx = dx_;
+        state.dy = dy_;
+        state.err = err_;
+        state.sx = sx_;
+        state.sy = sy_;
+        state.valid = valid_;
+        return state;
     }
-    std::vector<Coord> result;
-    std::transform(tmp.cbegin(), tmp.cend(), std::back_inserter(result), [](const Cell& cell)
+    //! \brief Check if there is a path at all.
+    bool Empty() const
     {
-        CheckFatal(cell.x >= 0 && cell.y >= 0);
-        return Coord(cell.x, cell.y);
-    });
-    return result;
-}
+        return !valid_;
+    }
+    //! \brief Current cell of the path.
+    Coord Current() const
+    {
+        assert(valid_);
+        return { x_, y_ };
+    }
+    //! \brief Target cell of the path.
+    Coord Target() const
+    {
+        assert(valid_);
+        return { end_x_, end_y_ };
+    }
+    //! \brief Check if the current cell is the last one.
+    bool AtEnd() const
+    {
+        return remaining_ == 0;
+    }
+    //! \brief Move to the next cell of the path. Must not be called at the end.
+    void Advance()
+    {
+        assert(valid_ && !AtEnd());
+        const int64_t err2 = err_ * 2;
+        //Selects instead of branches: which coordinate steps changes along the line and is hard to predict.
+        const bool step_x = err2 > -static_cast<int64_t>(dy_);
+        const bool step_y = err2 < static_cast<int64_t>(dx_);
+        err_ += (step_y ? static_cast<int64_t>(dx_) : 0) - (step_x ? static_cast<int64_t>(dy_) : 0);
+        x_ += step_x ? sx_ : 0;
+        y_ += step_y ? sy_ : 0;
+        --remaining_;
+    }
+private:
+    static uint32_t Distance(uint32_t from, uint32_t to)
+    {
+        return from < to ? to - from : from - to;
+    }
+private:
+    uint32_t x_;
+    uint32_t y_;
+    uint32_t end_x_;
+    uint32_t end_y_;
+    uint32_t dx_;
+    uint32_t dy_;
+    int64_t err_;
+    int8_t sx_;
+    int8_t sy_;
+    bool valid_;
+    //Steps left: the longer axis advances on every step.
+    uint32_t remaining_;
+};
 
 };
 
@@ -0,0 +1,171 @@
+#ifndef __ID_INDEX_H__
+#define __ID_INDEX_H__
+#include <cstdint>
+#include <vector>
+#include "helper.h"
+
+namespace sw
+{
+
+/*! \brief Index of unit slots by unit id.
+
+    While ids are compact (the largest id is comparable with the number of units) the slots
+    are kept in a vector addressed by id. Once an id far beyond that appears, the index moves
+    to an open-addressing hash table with linear probing and stays there.
+    Units are never removed, so neither layout needs tombstones.
+*/
+class IdIndex
+{
+public:
+    IdIndex()
+        :   hashed_(false)
+        ,   size_(0)
+        ,   shift_(0)
+    {
+        ;
+    }
+
+    //! \brief Get slot of the unit. kNoSlot if the id is unknown.
+    uint32_t Find(uint32_t id) const
+    {
+        if(!hashed_)
+        {
+            return id < dense_.size() ? dense_[id] : kNoSlot;
+        }
+        for(auto pos = Bucket(id); ; pos = (pos + 1) & Mask())
+        {
+            const auto& entry = table_[pos];
+            if(entry.slot == kNoSlot || entry.id == id)
+            {
+                return entry.slot;
+            }
+        }
+    }
+
+    /*! \brief Remember slot of the unit.
+        \return false if the id is already known, the index is not changed then.
+    */
+    bool Insert(uint32_t id, uint32_t slot)
+    {
+        CheckFatal(slot != kNoSlot);
+        if(Find(id) != kNoSlot)
+        {
+            return false;
+        }
+        if(!hashed_ && !FitsDense(id))
+        {
+            MoveToTable();
+        }
+        if(!hashed_)
+        {
+            if(id >= dense_.size())
+            {
+                dense_.resize(std::max<size_t>(static_cast<size_t>(id) + 1, dense_.size() * 2), kNoSlot);
+            }
+            dense_[id] = slot;
+        }
+        else
+        {
+            if((size_ + 1) * 2 > table_.size())
+            {
+                Rehash(table_.size() * 2);
+            }
+            Place(id, slot);
+        }
+        ++size_;
+        return true;
+    }
+
+    //! \brief Number of ids known.
+    size_t Size() const
+    {
+        return size_;
+    }
+
+    //! \brief Check if the index has moved to the hash table.
+    bool Hashed() const
+    {
+        return hashed_;
+    }
+
+private:
+    struct Entry
+    {
+        uint32_t id = 0;
+        uint32_t slot = kNoSlot;
+    };
+
+    //! \brief Ids up to this bound are kept densely whatever the number of units is.
+    static constexpr uint64_t kDenseSlack = 1 << 16;
+    static constexpr size_t kInitialBuckets = 16;
+
+    bool FitsDense(uint32_t id) const
+    {
+        return id < kDenseSlack + 4 * static_cast<uint64_t>(size_ + 1);
+    }
+    size_t Mask() const
+    {
+        return table_.size() - 1;
+    }
+    size_t Bucket(uint32_t id) const
+    {
+        //Fibonacci hashing: take the upper bits of the product.
+        return static_cast<size_t>((id * uint64_t(0x9E3779B97F4A7C15)) >> shift_);
+    }
+    void Place(uint32_t id, uint32_t slot)
+    {
+        auto pos = Bucket(id);
+        while(table_[pos].slot != kNoSlot)
+        {
+            pos = (pos + 1) & Mask();
+        }
+        table_[pos] = { id, slot };
+    }
+    void Rehash(size_t buckets)
+    {
+        std::vector<Entry> old;
+        old.swap(table_);
+        table_.resize(buckets);
+        shift_ = 64;
+        for(size_t count = buckets; count > 1; count >>= 1)
+        {
+            --shift_;
+        }
+        for(const auto& entry : old)
+        {
+            if(entry.slot != kNoSlot)
+            {
+                Place(entry.id, entry.slot);
+            }
+        }
+    }
+    void MoveToTable()
+    {
+        size_t buckets = kInitialBuckets;
+        while(buckets < (size_ + 1) * 2)
+        {
+            buckets *= 2;
+        }
+        Rehash(buckets);
+        for(size_t id = 0; id < dense_.size(); ++id)
+        {
+            if(dense_[id] != kNoSlot)
+            {
+                Place(static_cast<uint32_t>(id), dense_[id]);
+            }
+        }
+        std::vector<uint32_t>().swap(dense_);
+        hashed_ = true;
+    }
+
+private:
+    bool hashed_;
+    size_t size_;
+    unsigned shift_;
+    std::vector<uint32_t> dense_;
+    std::vector<Entry> table_;
+};
+
+}//namespace sw
+
+#endif /*__ID_INDEX_H__*/
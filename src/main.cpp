@@ -15,78 +15,211 @@
 #include <IO/Events/UnitDied.hpp>
 #include <IO/Events/UnitAttacked.hpp>
 #include <memory>
+#include <sstream>
+#include <string>
 #include "actors.h"
+#include "batch.h"
 #include "helper.h"
+#include "simulation.h"
 
-namespace sw
+int main(int argc, char** argv)
 {
+	using namespace sw;
 
-class SimulatingMachine
-{
-public:
-	SimulatingMachine(const char* filename)
-		:	file_(filename)
-	{
-		Expected(!!file_, "File not found");
-		parser_
-			.add<io::CreateMap>(
-				[this](auto command)
-				{
-					Expected(!field_, "Already created");
-					field_ = CreateBattleField(command);
-				})
-			.add<io::SpawnWarrior>(
-				[this](auto command)
-				{
-					Expected(!!field_, "Battle field has not been created");
-					field_->AddUnit(command);
-				})
-			.add<io::SpawnArcher>(
-				[this](auto command)
-				{
-					Expected(!!field_, "Battle field has not been created");
-					field_->AddUnit(command);
-				})
-			.add<io::March>(
-				[this](auto command)
-				{
-					Expected(!!field_, "Battle field has not been created");
-					field_->MarchTo(command);
-				});
-	}
-	void Run()
+	BattleFieldOptions options;
+	EventSinkOptions log_options;
+	const char* filename = nullptr;
+	std::string batch;
+	bool stream = false;
+	std::string profile;
+	std::string checkpoint;
+	uint64_t checkpoint_every = 0;
+	std::string restore;
+	std::string state_hashes;
+	bool diagnostics = false;
+	BatchOptions batch_options;
+	for (int i = 1; i < argc; ++i)
 	{
-		parser_.parse(file_);
-		while(true)
-		{
-			//const auto ch = getchar();
-			std::cout << std::endl;
-			AcquireLogger()->NextTick();
-			const bool steps_more = field_->DoNextStep();
-			if(!steps_more)
+		const std::string arg = argv[i];
+		if (arg == "--engine=classic")
+		{
+			options.engine = BattleFieldOptions::classic;
+		}
+		else if (arg == "--engine=soa")
+		{
+			options.engine = BattleFieldOptions::soa;
+		}
+		else if (arg == "--idle-units")
+		{
+			options.idle_units = true;
+		}
+		else if (arg.rfind("--expected-units=", 0) == 0)
+		{
+			options.expected_units = std::stoull(arg.substr(std::string("--expected-units=").size()));
+		}
+		else if (arg.rfind("--threads=", 0) == 0)
+		{
+			options.threads = static_cast<uint32_t>(std::stoul(arg.substr(std::string("--threads=").size())));
+		}
+		else if (arg == "--async-log" || arg == "--async-log=block")
+		{
+			log_options.async = true;
+		}
+		else if (arg == "--async-log=drop")
+		{
+			log_options.async = true;
+			log_options.asyncOptions.overflow = AsyncLogOptions::Overflow::drop;
+		}
+		else if (arg == "--log=stdout")
+		{
+			log_options.target = EventSinkOptions::Target::standardOutput;
+		}
+		else if (arg == "--log=none")
+		{
+			log_options.target = EventSinkOptions::Target::none;
+		}
+		else if (arg.rfind("--log=file:", 0) == 0)
+		{
+			log_options.target = EventSinkOptions::Target::textFile;
+			log_options.path = arg.substr(std::string("--log=file:").size());
+		}
+		else if (arg.rfind("--log=binary:", 0) == 0)
+		{
+			log_options.target = EventSinkOptions::Target::binaryFile;
+			log_options.path = arg.substr(std::string("--log=binary:").size());
+		}
+		else if (arg.rfind("--binary-log=", 0) == 0)
+		{
+			log_options.target = EventSinkOptions::Target::binaryFile;
+			log_options.path = arg.substr(std::string("--binary-log=").size());
+		}
+		else if (arg.rfind("--log-events=", 0) == 0)
+		{
+			std::istringstream names(arg.substr(std::string("--log-events=").size()));
+			for (std::string name; std::getline(names, name, ',');)
 			{
-				break;
+				if (!name.empty())
+					log_options.events.push_back(name);
 			}
 		}
+		else if (arg == "--stream")
+		{
+			stream = true;
+		}
+		else if (arg == "--profile")
+		{
+			profile = "-";
+		}
+		else if (arg.rfind("--profile=", 0) == 0)
+		{
+			profile = arg.substr(std::string("--profile=").size());
+		}
+		else if (arg.rfind("--checkpoint=", 0) == 0)
+		{
+			checkpoint = arg.substr(std::string("--checkpoint=").size());
+		}
+		else if (arg.rfind("--checkpoint-every=", 0) == 0)
+		{
+			checkpoint_every = std::stoull(arg.substr(std::string("--checkpoint-every=").size()));
+		}
+		else if (arg.rfind("--restore=", 0) == 0)
+		{
+			restore = arg.substr(std::string("--restore=").size());
+		}
+		else if (arg.rfind("--state-hash=", 0) == 0)
+		{
+			state_hashes = arg.substr(std::string("--state-hash=").size());
+		}
+		else if (arg == "--diagnostics")
+		{
+			diagnostics = true;
+		}
+		else if (arg.rfind("--batch=", 0) == 0)
+		{
+			batch = arg.substr(std::string("--batch=").size());
+		}
+		else if (arg.rfind("--jobs=", 0) == 0)
+		{
+			batch_options.jobs = static_cast<unsigned>(std::stoul(arg.substr(std::string("--jobs=").size())));
+		}
+		else if (arg.rfind("--output-dir=", 0) == 0)
+		{
+			batch_options.output_dir = arg.substr(std::string("--output-dir=").size());
+		}
+		else if (!filename)
+		{
+			filename = argv[i];
+		}
+		else
+		{
+			throw std::runtime_error("Error: Unexpected command line argument: " + arg);
+		}
 	}
-private:
-	std::ifstream file_;
-	io::CommandParser parser_;
-	std::unique_ptr<IBattleField> field_;
-};
-
-}//namespace sw
-
-int main(int argc, char** argv)
-{
-	using namespace sw;
-
-	if (argc != 2)
+	Expected(profile.empty() || TickProfiler::kEnabled, "Profiling is not compiled in, build with SW_PROFILE=ON");
+	if (!batch.empty())
+	{
+		Expected(!filename, "Batch mode takes no command file");
+		Expected(profile.empty(), "Batch mode does not profile");
+		Expected(checkpoint.empty() && restore.empty(), "Batch mode does not checkpoint");
+		Expected(state_hashes.empty(), "Batch mode does not write state hashes");
+		batch_options.scenarios = ListScenarios(batch);
+		batch_options.field = options;
+		batch_options.log = log_options;
+		const auto summary = RunBatch(batch_options);
+		PrintSummary(std::cout, summary);
+		return summary.failed ? 1 : 0;
+	}
+	if (!filename && restore.empty())
 	{
 		throw std::runtime_error("Error: No file specified in command line argument");
 	}
-	sw::SimulatingMachine sm(argv[1]);
-	sm.Run();
+	Expected(!filename || restore.empty(), "A restored battle takes no command file");
+	Expected(!stream || (checkpoint.empty() && restore.empty()), "Stream mode does not checkpoint");
+	sw::SimulatingMachine sm(options, createEventSink(log_options));
+	TickProfiler profiler;
+	if (!profile.empty())
+		sm.SetProfiler(&profiler);
+	if (!state_hashes.empty())
+		sm.SetStateHashes(state_hashes);
+	if (!checkpoint.empty())
+		sm.SetCheckpoints(checkpoint, checkpoint_every ? checkpoint_every : 1000);
+	if (!restore.empty())
+	{
+		sm.Restore(restore.c_str());
+	}
+	else if (stream)
+	{
+		//Commands are applied as they are read, "-" reads them from stdin.
+		std::ifstream file;
+		if (std::string(filename) != "-")
+		{
+			file.open(filename);
+			Expected(!!file, "File not found");
+		}
+		sm.RunStream(file.is_open() ? file : std::cin);
+	}
+	else
+	{
+		sm.Run(filename);
+	}
+	if (diagnostics)
+	{
+		const auto field = sm.Diagnostics();
+		std::cout.flush();
+		std::cerr << "occupancy: " << field.occupancy << ", " << field.occupancy_memory << " bytes; units: " << field.units << std::endl;
+	}
+	if (profile == "-")
+	{
+		//The summary goes to stderr, after the events.
+		std::cout.flush();
+		profiler.WriteText(std::cerr);
+	}
+	else if (!profile.empty())
+	{
+		std::ofstream report(profile);
+		Expected(!!report, "Could not open the profile report");
+		profiler.WriteJson(report);
+	}
 
 	return 0;
 }
@@ -0,0 +1,358 @@
+#ifndef __OCCUPANCY_H__
+#define __OCCUPANCY_H__
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include "helper.h"
+
+namespace sw
+{
+
+/*
+    Occupancy indexes: map a cell of the battle field to the slot of the unit standing there.
+    Each index provides the same set of operations:
+        uint32_t Find(const Coord&) const   - slot in the cell or kNoSlot;
+        void Occupy(const Coord&, uint32_t) - put slot into the cell, overwriting previous one;
+        void Vacate(const Coord&)           - make the cell free;
+        uint64_t MemoryUsage() const        - bytes currently allocated by the index.
+    Cells out of the map are never looked up, so they are silently ignored by the grid indexes.
+*/
+
+//! \brief Layout of an occupancy index.
+enum class OccupancyLayout
+{
+    flat,   //!< Single row-major array of slots.
+    tiled,  //!< Row-major directory of lazily allocated square tiles.
+    sparse  //!< Hash of tiles allocated while units stand in them, for maps too large for a directory of tiles.
+};
+
+//! \brief Flat row-major grid of slots: one array access per operation.
+class FlatOccupancy
+{
+public:
+    static constexpr OccupancyLayout kLayout = OccupancyLayout::flat;
+    //! \brief Maximal number of cells the flat layout is chosen for.
+    static constexpr uint64_t kMaxCells = uint64_t(1) << 22;
+    //! \brief A larger map is flat too when it has no more than this many cells per unit, up to kMaxCellsForUnits.
+    static constexpr uint64_t kCellsPerUnit = 16;
+    static constexpr uint64_t kMaxCellsForUnits = uint64_t(1) << 26;
+
+    FlatOccupancy(uint32_t width, uint32_t height)
+        :   width_(width)
+        ,   height_(height)
+        ,   cells_(static_cast<size_t>(width) * height, kNoSlot)
+    {
+        ;
+    }
+    uint32_t Find(const Coord& coord) const
+    {
+        return Inside(coord) ? cells_[Index(coord)] : kNoSlot;
+    }
+    void Occupy(const Coord& coord, uint32_t slot)
+    {
+        if(Inside(coord))
+        {
+            cells_[Index(coord)] = slot;
+        }
+    }
+    void Vacate(const Coord& coord)
+    {
+        Occupy(coord, kNoSlot);
+    }
+    uint64_t MemoryUsage() const
+    {
+        return EstimateMemory(width_, height_);
+    }
+    static uint64_t EstimateMemory(uint32_t width, uint32_t height)
+    {
+        return static_cast<uint64_t>(width) * height * sizeof(uint32_t);
+    }
+private:
+    bool Inside(const Coord& coord) const
+    {
+        return coord.x < width_ && coord.y < height_;
+    }
+    size_t Index(const Coord& coord) const
+    {
+        return static_cast<size_t>(coord.y) * width_ + coord.x;
+    }
+private:
+    uint32_t width_;
+    uint32_t height_;
+    std::vector<uint32_t> cells_;
+};
+
+//! \brief Row-major directory of square tiles. A tile is allocated when a unit enters it first time.
+class TiledOccupancy
+{
+public:
+    static constexpr OccupancyLayout kLayout = OccupancyLayout::tiled;
+    static constexpr uint32_t kTileShift = 6;
+    static constexpr uint32_t kTileSide = uint32_t(1) << kTileShift;
+    static constexpr uint32_t kTileMask = kTileSide - 1;
+    //! \brief Maximal number of tiles the tiled layout is chosen for.
+    static constexpr uint64_t kMaxTiles = uint64_t(1) << 22;
+    //! \brief Maximal number of tiles per unit: fewer units leave the directory mostly empty.
+    static constexpr uint64_t kMaxTilesPerUnit = 64;
+
+    TiledOccupancy(uint32_t width, uint32_t height)
+        :   width_(width)
+        ,   height_(height)
+        ,   tiles_x_(TilesAlong(width))
+        ,   tiles_(static_cast<size_t>(TilesAlong(width)) * TilesAlong(height))
+        ,   allocated_(0)
+    {
+        ;
+    }
+    uint32_t Find(const Coord& coord) const
+    {
+        if(!Inside(coord))
+        {
+            return kNoSlot;
+        }
+        const auto& tile = tiles_[TileIndex(coord)];
+        return tile ? (*tile)[CellIndex(coord)] : kNoSlot;
+    }
+    void Occupy(const Coord& coord, uint32_t slot)
+    {
+        if(!Inside(coord))
+        {
+            return;
+        }
+        auto& tile = tiles_[TileIndex(coord)];
+        if(!tile)
+        {
+            tile = std::make_unique<Tile>();
+            tile->fill(kNoSlot);
+            ++allocated_;
+        }
+        (*tile)[CellIndex(coord)] = slot;
+    }
+    void Vacate(const Coord& coord)
+    {
+        if(!Inside(coord))
+        {
+            return;
+        }
+        auto& tile = tiles_[TileIndex(coord)];
+        if(tile)
+        {
+            (*tile)[CellIndex(coord)] = kNoSlot;
+        }
+    }
+    uint64_t MemoryUsage() const
+    {
+        return EstimateMemory(width_, height_) + allocated_ * sizeof(Tile);
+    }
+    //! \brief Memory of the tile directory, tiles are allocated on demand.
+    static uint64_t EstimateMemory(uint32_t width, uint32_t height)
+    {
+        return TileCount(width, height) * sizeof(std::unique_ptr<Tile>);
+    }
+    static uint64_t TileCount(uint32_t width, uint32_t height)
+    {
+        return static_cast<uint64_t>(TilesAlong(width)) * TilesAlong(height);
+    }
+private:
+    using Tile = std::array<uint32_t, kTileSide * kTileSide>;
+
+    static uint32_t TilesAlong(uint32_t side)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(side) + kTileMask) >> kTileShift);
+    }
+    bool Inside(const Coord& coord) const
+    {
+        return coord.x < width_ && coord.y < height_;
+    }
+    size_t TileIndex(const Coord& coord) const
+    {
+        return static_cast<size_t>(coord.y >> kTileShift) * tiles_x_ + (coord.x >> kTileShift);
+    }
+    static size_t CellIndex(const Coord& coord)
+    {
+        return ((coord.y & kTileMask) << kTileShift) | (coord.x & kTileMask);
+    }
+private:
+    uint32_t width_;
+    uint32_t height_;
+    uint32_t tiles_x_;
+    std::vector<std::unique_ptr<Tile>> tiles_;
+    uint64_t allocated_;
+};
+
+/*! \brief Hash of square tiles by their coordinates, for maps too large for a directory of tiles.
+    A tile is allocated when a unit enters it first and freed once it is left empty, so memory follows the units only.
+*/
+class SparseOccupancy
+{
+public:
+    static constexpr OccupancyLayout kLayout = OccupancyLayout::sparse;
+    static constexpr uint32_t kTileShift = 4;
+    static constexpr uint32_t kTileSide = uint32_t(1) << kTileShift;
+    static constexpr uint32_t kTileMask = kTileSide - 1;
+    //! \brief Tiles left empty which are kept until the next sweep.
+    static constexpr size_t kMaxEmptied = 256;
+
+    SparseOccupancy(uint32_t, uint32_t)
+    {
+        ;
+    }
+    uint32_t Find(const Coord& coord) const
+    {
+        const auto iter = tiles_.find(TileKey(coord));
+        return iter == tiles_.end() ? kNoSlot : iter->second.cells[CellIndex(coord)];
+    }
+    void Occupy(const Coord& coord, uint32_t slot)
+    {
+        auto [iter, inserted] = tiles_.try_emplace(TileKey(coord));
+        auto& tile = iter->second;
+        if(inserted)
+        {
+            tile.cells.fill(kNoSlot);
+        }
+        auto& cell = tile.cells[CellIndex(coord)];
+        tile.occupied += static_cast<uint32_t>(cell == kNoSlot);
+        cell = slot;
+    }
+    void Vacate(const Coord& coord)
+    {
+        const auto key = TileKey(coord);
+        const auto iter = tiles_.find(key);
+        if(iter == tiles_.end())
+        {
+            return;
+        }
+        auto& tile = iter->second;
+        auto& cell = tile.cells[CellIndex(coord)];
+        if(cell == kNoSlot)
+        {
+            return;
+        }
+        cell = kNoSlot;
+        if(!--tile.occupied)
+        {
+            //A unit steps by vacating its cell and occupying the next one, often in the same tile:
+            //empty tiles are freed in sweeps, not on the spot.
+            emptied_.push_back(key);
+            if(emptied_.size() > kMaxEmptied)
+            {
+                Sweep();
+            }
+        }
+    }
+    uint64_t MemoryUsage() const
+    {
+        //A node per tile holding the key, the tile and the link, plus the buckets.
+        return tiles_.size() * (sizeof(uint64_t) + sizeof(Tile) + 2 * sizeof(void*)) + tiles_.bucket_count() * sizeof(void*);
+    }
+    static uint64_t EstimateMemory(uint32_t, uint32_t)
+    {
+        return 0;
+    }
+private:
+    struct Tile
+    {
+        std::array<uint32_t, kTileSide * kTileSide> cells;
+        uint32_t occupied = 0;
+    };
+
+    static uint64_t TileKey(const Coord& coord)
+    {
+        return (static_cast<uint64_t>(coord.x >> kTileShift) << 32) | (coord.y >> kTileShift);
+    }
+    static size_t CellIndex(const Coord& coord)
+    {
+        return ((coord.y & kTileMask) << kTileShift) | (coord.x & kTileMask);
+    }
+    //! \brief Free the tiles left empty which no unit has entered since.
+    void Sweep()
+    {
+        for(const auto key : emptied_)
+        {
+            const auto iter = tiles_.find(key);
+            if(iter != tiles_.end() && !iter->second.occupied)
+            {
+                tiles_.erase(iter);
+            }
+        }
+        emptied_.clear();
+    }
+private:
+    std::unordered_map<uint64_t, Tile> tiles_;
+    std::vector<uint64_t> emptied_;
+};
+
+/*! \brief Select the layout for the map: a dense grid while the map is small or crowded enough, sparse tiles otherwise.
+    \param units Expected number of units, 0 if unknown.
+*/
+inline OccupancyLayout ChooseOccupancyLayout(uint32_t width, uint32_t height, uint64_t units = 0)
+{
+    const uint64_t cells = static_cast<uint64_t>(width) * height;
+    if(cells <= FlatOccupancy::kMaxCells ||
+       cells <= std::min(units * FlatOccupancy::kCellsPerUnit, FlatOccupancy::kMaxCellsForUnits))
+    {
+        return OccupancyLayout::flat;
+    }
+    const auto tiles = TiledOccupancy::TileCount(width, height);
+    if(tiles <= TiledOccupancy::kMaxTiles && (!units || tiles <= units * TiledOccupancy::kMaxTilesPerUnit))
+    {
+        return OccupancyLayout::tiled;
+    }
+    return OccupancyLayout::sparse;
+}
+
+//! \brief Name of the layout for diagnostics.
+inline const char* OccupancyLayoutName(OccupancyLayout layout)
+{
+    switch(layout)
+    {
+    case OccupancyLayout::flat:
+        return "flat";
+    case OccupancyLayout::tiled:
+        return "tiled";
+    case OccupancyLayout::sparse:
+        return "sparse";
+    }
+    return "unknown";
+}
+
+//! \brief Carries an occupancy type to the generic code choosing one.
+template<typename TOccupancy>
+struct OccupancyTag
+{
+    using type = TOccupancy;
+};
+
+/*! \brief Instantiate the code for the layout, see ChooseOccupancyLayout.
+    \param maker Generic callable taking OccupancyTag of the chosen index.
+*/
+template<typename TMaker>
+auto WithOccupancy(OccupancyLayout layout, TMaker&& maker)
+{
+    switch(layout)
+    {
+    case OccupancyLayout::flat:
+        return maker(OccupancyTag<FlatOccupancy>{});
+    case OccupancyLayout::tiled:
+        return maker(OccupancyTag<TiledOccupancy>{});
+    case OccupancyLayout::sparse:
+        break;
+    }
+    return maker(OccupancyTag<SparseOccupancy>{});
+}
+
+//! \brief Memory allocated upfront by the layout.
+inline uint64_t EstimateOccupancyMemory(OccupancyLayout layout, uint32_t width, uint32_t height)
+{
+    return WithOccupancy(layout, [width, height](auto tag)
+    {
+        return decltype(tag)::type::EstimateMemory(width, height);
+    });
+}
+
+}//namespace sw
+
+#endif /*__OCCUPANCY_H__*/
@@ -0,0 +1,238 @@
+#ifndef __OCCUPANCY_BITS_H__
+#define __OCCUPANCY_BITS_H__
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "helper.h"
+#include "rings.h"
+
+namespace sw
+{
+
+/*
+    Bitboard of the cells holding a living unit, kept alongside the occupancy index to skip empty parts of a ring.
+
+    A word holds the bits of a block of 8x8 cells, a region of 64x64 cells holds 8x8 blocks and a summary word
+    with a bit per non-empty block. In both words bit `row * 8 + column` stands for the cell or the block.
+    Whether a rectangle holds any set bit costs a summary test per region it crosses and a word test
+    per non-empty block, instead of a lookup per cell.
+    Regions are kept in a row-major directory, or in a hash for maps too large for one, like the occupancy indexes.
+    Like the grid indexes, it ignores cells out of the map: a unit marching to a target off the map walks out of it.
+*/
+class OccupancyBits
+{
+public:
+    static constexpr uint32_t kBlockShift = 3;
+    static constexpr uint32_t kBlockMask = (uint32_t(1) << kBlockShift) - 1;
+    static constexpr uint32_t kRegionShift = 2 * kBlockShift;
+    //! \brief Maximal number of regions of a map which are kept in a directory.
+    static constexpr uint64_t kMaxDirectory = uint64_t(1) << 20;
+    //! \brief Regions left empty which are kept until the next sweep, when hashed.
+    static constexpr size_t kMaxEmptied = 256;
+
+    OccupancyBits(uint32_t width, uint32_t height)
+        :   width_(width)
+        ,   height_(height)
+        ,   regions_x_(Regions(width))
+    {
+        const auto regions = regions_x_ * Regions(height);
+        if(regions <= kMaxDirectory)
+        {
+            directory_.resize(static_cast<size_t>(regions));
+        }
+        hashed_ = directory_.empty();
+    }
+    //! \brief Set or clear the bit of the cell.
+    void Set(const Coord& cell, bool bit)
+    {
+        if(cell.x >= width_ || cell.y >= height_)
+        {
+            return;
+        }
+        auto* region = bit ? AcquireRegion(cell) : FindRegion(cell.x >> kRegionShift, cell.y >> kRegionShift);
+        if(!region)
+        {
+            return;
+        }
+        const auto block = Index(cell.x >> kBlockShift, cell.y >> kBlockShift);
+        const auto mask = uint64_t(1) << Index(cell.x, cell.y);
+        auto& word = region->blocks[block];
+        word = bit ? (word | mask) : (word & ~mask);
+        const auto summary = uint64_t(1) << block;
+        region->summary = word ? (region->summary | summary) : (region->summary & ~summary);
+        if(hashed_ && !region->summary)
+        {
+            //Like a tile of SparseOccupancy, the region is likely to be entered again by the next step.
+            emptied_.push_back(Key(cell.x >> kRegionShift, cell.y >> kRegionShift));
+            if(emptied_.size() > kMaxEmptied)
+            {
+                Sweep();
+            }
+        }
+    }
+    //! \brief Whether any bit of the cells [x_from, x_to] x [y_from, y_to] is set.
+    bool Any(uint32_t x_from, uint32_t x_to, uint32_t y_from, uint32_t y_to) const
+    {
+        for(auto rx = x_from >> kRegionShift; rx <= (x_to >> kRegionShift); ++rx)
+        {
+            const auto bx_from = Clip(x_from, rx << kRegionShift) >> kBlockShift;
+            const auto bx_to = Clip(x_to, rx << kRegionShift) >> kBlockShift;
+            for(auto ry = y_from >> kRegionShift; ry <= (y_to >> kRegionShift); ++ry)
+            {
+                const auto* region = FindRegion(rx, ry);
+                if(!region)
+                {
+                    continue;
+                }
+                const auto by_from = Clip(y_from, ry << kRegionShift) >> kBlockShift;
+                const auto by_to = Clip(y_to, ry << kRegionShift) >> kBlockShift;
+                auto blocks = region->summary & Mask(bx_from, bx_to, by_from, by_to);
+                while(blocks)
+                {
+                    const auto block = static_cast<uint32_t>(std::countr_zero(blocks));
+                    blocks &= blocks - 1;
+                    //Cells of the block inside the rectangle.
+                    const auto x = ((rx << kBlockShift) | (block & kBlockMask)) << kBlockShift;
+                    const auto y = ((ry << kBlockShift) | (block >> kBlockShift)) << kBlockShift;
+                    const auto mask = Mask(Clip(x_from, x), Clip(x_to, x), Clip(y_from, y), Clip(y_to, y));
+                    if(region->blocks[block] & mask)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+    uint64_t MemoryUsage() const
+    {
+        return directory_.size() * sizeof(void*) + allocated_ * sizeof(Region) +
+            hash_.size() * (sizeof(uint64_t) + sizeof(Region) + 2 * sizeof(void*)) + hash_.bucket_count() * sizeof(void*);
+    }
+private:
+    struct Region
+    {
+        uint64_t summary = 0;
+        std::array<uint64_t, 64> blocks{};
+    };
+
+    static uint64_t Regions(uint32_t cells)
+    {
+        return (static_cast<uint64_t>(cells) + (uint64_t(1) << kRegionShift) - 1) >> kRegionShift;
+    }
+    static uint64_t Key(uint32_t rx, uint32_t ry)
+    {
+        return (static_cast<uint64_t>(rx) << 32) | ry;
+    }
+    //! \brief Bit of the cell in its block, or of the block in its region.
+    static uint32_t Index(uint32_t x, uint32_t y)
+    {
+        return ((y & kBlockMask) << kBlockShift) | (x & kBlockMask);
+    }
+    //! \brief The coordinate clipped to the 8 or 64 cells starting at `from`, relative to it.
+    static uint32_t Clip(uint32_t coordinate, uint32_t from)
+    {
+        return std::max(coordinate, from) - from;
+    }
+    //! \brief Bits of the columns [x_from, x_to] and the rows [y_from, y_to] of a word. The ends are clipped to 7.
+    static uint64_t Mask(uint32_t x_from, uint32_t x_to, uint32_t y_from, uint32_t y_to)
+    {
+        x_to = std::min(x_to, kBlockMask);
+        y_to = std::min(y_to, kBlockMask);
+        const uint64_t row = (uint64_t(0xFF) >> (kBlockMask - x_to)) & (uint64_t(0xFF) << x_from);
+        const uint64_t rows = (~uint64_t(0) >> (8 * (kBlockMask - y_to))) & (~uint64_t(0) << (8 * y_from));
+        return (row * 0x0101010101010101ull) & rows;
+    }
+    const Region* FindRegion(uint32_t rx, uint32_t ry) const
+    {
+        if(!hashed_)
+        {
+            return directory_[static_cast<size_t>(ry * regions_x_ + rx)].get();
+        }
+        const auto iter = hash_.find(Key(rx, ry));
+        return iter == hash_.end() ? nullptr : &iter->second;
+    }
+    Region* FindRegion(uint32_t rx, uint32_t ry)
+    {
+        return const_cast<Region*>(static_cast<const OccupancyBits*>(this)->FindRegion(rx, ry));
+    }
+    Region* AcquireRegion(const Coord& cell)
+    {
+        const auto rx = cell.x >> kRegionShift;
+        const auto ry = cell.y >> kRegionShift;
+        if(hashed_)
+        {
+            return &hash_[Key(rx, ry)];
+        }
+        auto& region = directory_[static_cast<size_t>(ry * regions_x_ + rx)];
+        if(!region)
+        {
+            region = std::make_unique<Region>();
+            ++allocated_;
+        }
+        return region.get();
+    }
+    //! \brief Free the hashed regions left empty which no unit has entered since.
+    void Sweep()
+    {
+        for(const auto key : emptied_)
+        {
+            const auto iter = hash_.find(key);
+            if(iter != hash_.end() && !iter->second.summary)
+            {
+                hash_.erase(iter);
+            }
+        }
+        emptied_.clear();
+    }
+private:
+    uint32_t width_;
+    uint32_t height_;
+    uint64_t regions_x_;
+    bool hashed_ = false;
+    std::vector<std::unique_ptr<Region>> directory_;
+    uint64_t allocated_ = 0;
+    std::unordered_map<uint64_t, Region> hash_;
+    std::vector<uint64_t> emptied_;
+};
+
+//! \brief Rings of a smaller radius are narrower than a block: testing their bits costs more than walking their cells.
+constexpr uint32_t kMinMarkedRadius = 4;
+
+/*! \brief Visit cells of the ring like ForEachCoordinateAround, skipping strips of 8 columns
+    where no bit of `bits` is set. Only cells without a bit are skipped, the others are visited in the same order.
+    \param visitor bool(const Coord&), returns true to stop the enumeration.
+    \return true if the visitor stopped the enumeration.
+*/
+template<typename TVisitor>
+bool ForEachMarkedAround(const OccupancyBits& bits, const Coord& center, const Coord& extreme_point,
+    uint32_t radius_from, uint32_t radius_to, TVisitor&& visitor)
+{
+    if(radius_from > radius_to || radius_to < kMinMarkedRadius)
+    {
+        return ForEachCoordinateAround(center, extreme_point, radius_from, radius_to, visitor);
+    }
+    const auto x_from = center.x > radius_to ? center.x - radius_to : 0;
+    const auto y_from = center.y > radius_to ? center.y - radius_to : 0;
+    const auto x_to = static_cast<uint32_t>(std::min<uint64_t>(uint64_t(center.x) + radius_to, extreme_point.x));
+    const auto y_to = static_cast<uint32_t>(std::min<uint64_t>(uint64_t(center.y) + radius_to, extreme_point.y));
+    for(uint64_t x = x_from; x <= x_to;)
+    {
+        const auto strip_to = std::min<uint64_t>(x | OccupancyBits::kBlockMask, x_to);
+        if(bits.Any(static_cast<uint32_t>(x), static_cast<uint32_t>(strip_to), y_from, y_to) &&
+           ForEachCoordinateAround(center, extreme_point, radius_from, radius_to, x, strip_to, visitor))
+        {
+            return true;
+        }
+        x = strip_to + 1;
+    }
+    return false;
+}
+
+}//namespace sw
+
+#endif /*__OCCUPANCY_BITS_H__*/
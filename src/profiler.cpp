@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+#include "profiler.h"
+
+#if SW_PROFILE
+
+namespace
+{
+
+std::atomic<uint64_t> allocations{0};
+
+void* Allocate(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* pointer = std::malloc(size ? size : 1))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* AllocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    const auto align = static_cast<std::size_t>(alignment);
+#ifdef _MSC_VER
+    void* pointer = _aligned_malloc(size ? size : 1, align);
+#else
+    //aligned_alloc takes sizes which are multiples of the alignment only.
+    void* pointer = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) & ~(align - 1));
+#endif
+    if(pointer)
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void FreeAligned(void* pointer) noexcept
+{
+#ifdef _MSC_VER
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+}//namespace
+
+//Count heap allocations for the profiler.
+void* operator new(std::size_t size)
+{
+    return Allocate(size);
+}
+void* operator new[](std::size_t size)
+{
+    return Allocate(size);
+}
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+//The nothrow and over-aligned forms are replaced as well, so that every allocation is counted
+//and every block is released by the function matching the one which allocated it.
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return Allocate(size);
+    }
+    catch(const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return AllocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return AllocateAligned(size, alignment);
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return AllocateAligned(size, alignment);
+    }
+    catch(const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return operator new(size, alignment, std::nothrow);
+}
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    FreeAligned(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    FreeAligned(pointer);
+}
+
+#endif
+
+namespace sw
+{
+
+uint64_t AllocationCount()
+{
+#if SW_PROFILE
+    return allocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+namespace
+{
+
+const char* PhaseName(size_t phase)
+{
+    static const char* const names[TickProfiler::kPhases] =
+    {
+        "other", "occupancy", "movement", "neighbors", "target", "logging", "plan"
+    };
+    return names[phase];
+}
+
+}//namespace
+
+void TickProfiler::SetKinds(std::vector<std::string> names)
+{
+    kinds_ = std::move(names);
+    totals_.assign((kinds_.size() + 1) * kPhases, {});
+}
+
+void TickProfiler::BeginTick(uint64_t tick)
+{
+    if(totals_.empty())
+    {
+        totals_.assign((kinds_.size() + 1) * kPhases, {});
+    }
+    tick_record_ = {};
+    tick_record_.tick = tick;
+    allocations_at_start_ = AllocationCount();
+    stack_[0] = { ProfilePhase::other, static_cast<uint32_t>(kinds_.size()) };
+    depth_ = 1;
+    overflow_ = 0;
+    in_tick_ = true;
+    tick_start_ = last_ = Clock::now();
+}
+
+void TickProfiler::EndTick()
+{
+    if(!in_tick_)
+    {
+        return;
+    }
+    const auto now = Clock::now();
+    Charge(now);
+    tick_record_.total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - tick_start_).count();
+    tick_record_.allocations = AllocationCount() - allocations_at_start_;
+    ticks_.push_back(tick_record_);
+    in_tick_ = false;
+}
+
+void TickProfiler::Charge(Clock::time_point now)
+{
+    const auto& frame = stack_[depth_ - 1];
+    const auto phase = static_cast<size_t>(frame.phase);
+    const auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count());
+    tick_record_.phase_ns[phase] += ns;
+    totals_[frame.kind * kPhases + phase].ns += ns;
+    last_ = now;
+}
+
+void TickProfiler::Enter(ProfilePhase phase, uint32_t kind)
+{
+    if(!in_tick_)
+    {
+        return;
+    }
+    if(depth_ == std::size(stack_))
+    {
+        ++overflow_;
+        return;
+    }
+    Charge(Clock::now());
+    kind = kind == kSameKind ? stack_[depth_ - 1].kind : std::min<uint32_t>(kind, kinds_.size());
+    stack_[depth_++] = { phase, kind };
+    ++totals_[kind * kPhases + static_cast<size_t>(phase)].calls;
+}
+
+void TickProfiler::Leave()
+{
+    if(!in_tick_)
+    {
+        return;
+    }
+    if(overflow_)
+    {
+        --overflow_;
+        return;
+    }
+    if(depth_ < 2)
+    {
+        return;
+    }
+    Charge(Clock::now());
+    --depth_;
+}
+
+uint64_t TickProfiler::Percentile(double fraction) const
+{
+    if(ticks_.empty())
+    {
+        return 0;
+    }
+    std::vector<uint64_t> latencies;
+    latencies.reserve(ticks_.size());
+    for(const auto& record : ticks_)
+    {
+        latencies.push_back(record.total_ns);
+    }
+    const auto index = std::min(latencies.size() - 1, static_cast<size_t>(fraction * latencies.size()));
+    std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+    return latencies[index];
+}
+
+const std::string& TickProfiler::KindName(size_t kind) const
+{
+    static const std::string field = "field";
+    return kind < kinds_.size() ? kinds_[kind] : field;
+}
+
+void TickProfiler::WriteText(std::ostream& out) const
+{
+    uint64_t total_ns = 0;
+    uint64_t cells = 0;
+    uint64_t allocations = 0;
+    for(const auto& record : ticks_)
+    {
+        total_ns += record.total_ns;
+        cells += record.cells;
+        allocations += record.allocations;
+    }
+    const double ticks = ticks_.empty() ? 1.0 : static_cast<double>(ticks_.size());
+    const auto flags = out.flags();
+    out << std::fixed << std::setprecision(3)
+        << "Ticks: " << ticks_.size()
+        << ", tick latency us: p50 " << Percentile(0.5) / 1e3
+        << ", p99 " << Percentile(0.99) / 1e3
+        << ", mean " << total_ns / ticks / 1e3 << '\n'
+        << "Cells scanned per tick: " << cells / ticks
+        << ", allocations per tick: " << allocations / ticks << '\n';
+    for(size_t kind = 0; kind * kPhases < totals_.size(); ++kind)
+    {
+        for(size_t phase = 0; phase < kPhases; ++phase)
+        {
+            const auto& totals = totals_[kind * kPhases + phase];
+            if(!totals.ns && !totals.calls)
+            {
+                continue;
+            }
+            out << "  " << std::left << std::setw(14) << KindName(kind) << std::setw(10) << PhaseName(phase) << std::right
+                << std::setw(14) << totals.ns / 1e6 << " ms"
+                << std::setw(12) << totals.calls << " calls\n";
+        }
+    }
+    out.flush();
+    out.flags(flags);
+}
+
+void TickProfiler::WriteJson(std::ostream& out) const
+{
+    out << "{\n  \"ticks\": [";
+    for(size_t i = 0; i < ticks_.size(); ++i)
+    {
+        const auto& record = ticks_[i];
+        out << (i ? ",\n" : "\n") << "    {\"tick\": " << record.tick << ", \"ns\": " << record.total_ns;
+        for(size_t phase = 0; phase < kPhases; ++phase)
+        {
+            out << ", \"" << PhaseName(phase) << "_ns\": " << record.phase_ns[phase];
+        }
+        out << ", \"cells\": " << record.cells << ", \"allocations\": " << record.allocations << "}";
+    }
+    out << "\n  ],\n  \"latency_ns\": {\"p50\": " << Percentile(0.5) << ", \"p99\": " << Percentile(0.99) << "},\n  \"phases\": [";
+    bool first = true;
+    for(size_t kind = 0; kind * kPhases < totals_.size(); ++kind)
+    {
+        for(size_t phase = 0; phase < kPhases; ++phase)
+        {
+            const auto& totals = totals_[kind * kPhases + phase];
+            if(!totals.ns && !totals.calls)
+            {
+                continue;
+            }
+            out << (first ? "\n" : ",\n") << "    {\"kind\": \"" << KindName(kind) << "\", \"phase\": \"" << PhaseName(phase)
+                << "\", \"ns\": " << totals.ns << ", \"calls\": " << totals.calls << "}";
+            first = false;
+        }
+    }
+    out << "\n  ]\n}\n";
+    out.flush();
+}
+
+}//namespace sw
@@ -0,0 +1,188 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifndef SW_PROFILE
+#define SW_PROFILE 0
+#endif
+
+namespace sw
+{
+
+//! \brief Parts of a tick the profiler accounts time to.
+enum class ProfilePhase : uint8_t
+{
+    other,      //!< Time of the tick outside any other phase.
+    occupancy,  //!< Updates of the occupancy index.
+    movement,   //!< Unit logic: decisions and moves along the path.
+    neighbors,  //!< Enumeration of the cells around a unit, AcquireCoordinatesAround.
+    target,     //!< Search for a unit to attack, GetUnitToAttack and FindUnitToAttack.
+    logging,    //!< Logging of events.
+    plan,       //!< Parallel planning of the two-phase tick.
+    count
+};
+
+/*! \brief Time and counts per phase of every tick, per unit kind, and their aggregate.
+    Phases nest: time spent in a nested phase is not accounted to the enclosing one, so the phases of a tick sum up to it.
+    Calls are compiled out when SW_PROFILE is 0: use TickProfileScope and ProfileScope, and check kEnabled before other calls.
+*/
+class TickProfiler
+{
+public:
+    static constexpr bool kEnabled = SW_PROFILE;
+    static constexpr size_t kPhases = static_cast<size_t>(ProfilePhase::count);
+    //! \brief The phase is accounted to the kind of the enclosing phase.
+    static constexpr uint32_t kSameKind = ~uint32_t();
+
+    //! \brief Name unit kinds by the index passed to Enter. Work of no unit is accounted to "field".
+    void SetKinds(std::vector<std::string> names);
+
+    void BeginTick(uint64_t tick);
+    void EndTick();
+
+    //! \brief Start a phase of the work of a unit of the kind, nested in the current phase. Ignored outside a tick.
+    void Enter(ProfilePhase phase, uint32_t kind = kSameKind);
+    void Leave();
+    //! \brief Count cells looked up while searching around a unit.
+    void AddCells(uint64_t cells)
+    {
+        tick_record_.cells += cells;
+    }
+
+    //! \brief Print the aggregate report.
+    void WriteText(std::ostream& out) const;
+    //! \brief Write every tick and the aggregate as JSON.
+    void WriteJson(std::ostream& out) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct TickRecord
+    {
+        uint64_t tick = 0;
+        uint64_t total_ns = 0;
+        uint64_t phase_ns[kPhases] = {};
+        uint64_t cells = 0;
+        uint64_t allocations = 0;
+    };
+    struct PhaseTotals
+    {
+        uint64_t ns = 0;
+        uint64_t calls = 0;
+    };
+
+    struct Frame
+    {
+        ProfilePhase phase = ProfilePhase::other;
+        uint32_t kind = 0;
+    };
+
+    void Charge(Clock::time_point now);
+    uint64_t Percentile(double fraction) const;
+    const std::string& KindName(size_t kind) const;
+
+private:
+    std::vector<std::string> kinds_;
+    std::vector<TickRecord> ticks_;
+    //Totals by kind, the work of the battle field last, then by phase.
+    std::vector<PhaseTotals> totals_;
+
+    bool in_tick_ = false;
+    TickRecord tick_record_;
+    Clock::time_point tick_start_;
+    Clock::time_point last_;
+    uint64_t allocations_at_start_ = 0;
+    //Phases entered, the bottom one is the tick itself.
+    Frame stack_[16] = {};
+    uint32_t depth_ = 0;
+    //Phases entered beyond the depth of the stack, accounted to the deepest one.
+    uint32_t overflow_ = 0;
+};
+
+//! \brief Profiles the tick of its scope. Empty when profiling is compiled out.
+template<bool kEnabled>
+class BasicTickProfileScope
+{
+public:
+    //! \param profiler nullptr does nothing.
+    BasicTickProfileScope(TickProfiler* profiler, uint64_t tick)
+        :   profiler_(profiler)
+    {
+        if(profiler_)
+        {
+            profiler_->BeginTick(tick);
+        }
+    }
+    ~BasicTickProfileScope()
+    {
+        if(profiler_)
+        {
+            profiler_->EndTick();
+        }
+    }
+    BasicTickProfileScope(const BasicTickProfileScope&) = delete;
+    BasicTickProfileScope& operator=(const BasicTickProfileScope&) = delete;
+private:
+    TickProfiler* profiler_;
+};
+
+template<>
+class BasicTickProfileScope<false>
+{
+public:
+    BasicTickProfileScope(TickProfiler*, uint64_t)
+    {
+        ;
+    }
+};
+
+//! \brief Accounts the time of its scope to a phase. Empty when profiling is compiled out.
+template<bool kEnabled>
+class BasicProfileScope
+{
+public:
+    //! \param profiler nullptr does nothing.
+    BasicProfileScope(TickProfiler* profiler, ProfilePhase phase, uint32_t kind = TickProfiler::kSameKind)
+        :   profiler_(profiler)
+    {
+        if(profiler_)
+        {
+            profiler_->Enter(phase, kind);
+        }
+    }
+    ~BasicProfileScope()
+    {
+        if(profiler_)
+        {
+            profiler_->Leave();
+        }
+    }
+    BasicProfileScope(const BasicProfileScope&) = delete;
+    BasicProfileScope& operator=(const BasicProfileScope&) = delete;
+private:
+    TickProfiler* profiler_;
+};
+
+template<>
+class BasicProfileScope<false>
+{
+public:
+    BasicProfileScope(TickProfiler*, ProfilePhase, uint32_t = TickProfiler::kSameKind)
+    {
+        ;
+    }
+};
+
+using TickProfileScope = BasicTickProfileScope<TickProfiler::kEnabled>;
+using ProfileScope = BasicProfileScope<TickProfiler::kEnabled>;
+
+//! \brief Heap allocations made by the process so far. Always 0 when profiling is compiled out.
+uint64_t AllocationCount();
+
+}//namespace sw
+
+#endif /*__PROFILER_H__*/
@@ -0,0 +1,219 @@
+#ifndef __RINGS_H__
+#define __RINGS_H__
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <utility>
+#include "helper.h"
+
+namespace sw
+{
+
+/*
+    Enumeration of the cells around a center: all cells whose Chebyshev distance to the center
+    lies within [radius_from, radius_to], ordered by x and then by y, clipped by the map bounds.
+    This is the order CoordinatesAround has always produced.
+*/
+
+//! \brief Shift of a cell relative to the center.
+struct Offset
+{
+    int32_t dx = 0;
+    int32_t dy = 0;
+};
+
+//! \brief Radius up to which offsets are tabulated. Larger rings are walked column by column.
+constexpr uint32_t kMaxTabulatedRadius = 32;
+
+//! \brief Build offsets of the ring in the enumeration order.
+inline std::vector<Offset> BuildRingOffsets(uint32_t radius_from, uint32_t radius_to)
+{
+    std::vector<Offset> offsets;
+    if(radius_from > radius_to)
+    {
+        return offsets;
+    }
+    const auto to = static_cast<int32_t>(radius_to);
+    const auto from = static_cast<int32_t>(radius_from);
+    for(int32_t dx = -to; dx <= to; ++dx)
+    {
+        for(int32_t dy = -to; dy <= to; ++dy)
+        {
+            if(std::max(std::abs(dx), std::abs(dy)) >= from)
+            {
+                offsets.push_back({dx, dy});
+            }
+        }
+    }
+    return offsets;
+}
+
+//! \brief Offset tables of the rings requested so far, one per (radius_from, radius_to) pair.
+class RingOffsetCache
+{
+public:
+    /*! \brief Get the table of the ring.
+        \return nullptr if the ring is too large to be tabulated.
+    */
+    const std::vector<Offset>* Get(uint32_t radius_from, uint32_t radius_to)
+    {
+        if(radius_to > kMaxTabulatedRadius)
+        {
+            return nullptr;
+        }
+        const auto key = std::make_pair(radius_from, radius_to);
+        auto iter = tables_.find(key);
+        if(iter == tables_.end())
+        {
+            iter = tables_.emplace(key, BuildRingOffsets(radius_from, radius_to)).first;
+        }
+        return &iter->second;
+    }
+    /*! \brief Get the table of the ring if it has been built, without building it. Safe to call from several threads
+        as long as no thread calls Get at the same time.
+        \return nullptr if the table has not been built.
+    */
+    const std::vector<Offset>* Find(uint32_t radius_from, uint32_t radius_to) const
+    {
+        const auto iter = tables_.find(std::make_pair(radius_from, radius_to));
+        return iter == tables_.end() ? nullptr : &iter->second;
+    }
+private:
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<Offset>> tables_;
+};
+
+/*! \brief Visit cells of the ring using its offset table.
+    \param visitor bool(const Coord&), returns true to stop the enumeration.
+    \return true if the visitor stopped the enumeration.
+*/
+template<typename TVisitor>
+bool ForEachCoordinateAround(const std::vector<Offset>& offsets, const Coord& center, const Coord& extreme_point, TVisitor&& visitor)
+{
+    const auto cx = static_cast<int64_t>(center.x);
+    const auto cy = static_cast<int64_t>(center.y);
+    const auto ex = static_cast<int64_t>(extreme_point.x);
+    const auto ey = static_cast<int64_t>(extreme_point.y);
+    for(const auto& offset : offsets)
+    {
+        const auto x = cx + offset.dx;
+        const auto y = cy + offset.dy;
+        if(x < 0 || x > ex || y < 0 || y > ey)
+        {
+            continue;
+        }
+        if(visitor(Coord(static_cast<uint32_t>(x), static_cast<uint32_t>(y))))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! \brief Visit cells of the ring in the columns [x_from, x_to] only, column by column, clipping each column by the map bounds.
+    \param visitor bool(const Coord&), returns true to stop the enumeration.
+    \return true if the visitor stopped the enumeration.
+*/
+template<typename TVisitor>
+bool ForEachCoordinateAround(const Coord& center, const Coord& extreme_point, uint32_t radius_from, uint32_t radius_to,
+    int64_t x_from, int64_t x_to, TVisitor&& visitor)
+{
+    if(radius_from > radius_to)
+    {
+        return false;
+    }
+    const auto cx = static_cast<int64_t>(center.x);
+    const auto cy = static_cast<int64_t>(center.y);
+    const auto from = static_cast<int64_t>(radius_from);
+    const auto to = static_cast<int64_t>(radius_to);
+    const auto ex = static_cast<int64_t>(extreme_point.x);
+    const auto ey = static_cast<int64_t>(extreme_point.y);
+
+    auto visit_column = [&](int64_t x, int64_t y_from, int64_t y_to)
+    {
+        y_from = std::max<int64_t>(y_from, 0);
+        y_to = std::min(y_to, ey);
+        for(auto y = y_from; y <= y_to; ++y)
+        {
+            if(visitor(Coord(static_cast<uint32_t>(x), static_cast<uint32_t>(y))))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    x_to = std::min({ x_to, cx + to, ex });
+    for(auto x = std::max({ x_from, cx - to, int64_t(0) }); x <= x_to; ++x)
+    {
+        const auto dx = x > cx ? x - cx : cx - x;
+        if(dx >= from)
+        {
+            if(visit_column(x, cy - to, cy + to))
+            {
+                return true;
+            }
+            continue;
+        }
+        //The column crosses the hole of the ring.
+        if(visit_column(x, cy - to, cy - from) || visit_column(x, cy + from, cy + to))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! \brief Visit cells of the ring column by column, clipping each column by the map bounds.
+    \param visitor bool(const Coord&), returns true to stop the enumeration.
+    \return true if the visitor stopped the enumeration.
+*/
+template<typename TVisitor>
+bool ForEachCoordinateAround(const Coord& center, const Coord& extreme_point, uint32_t radius_from, uint32_t radius_to, TVisitor&& visitor)
+{
+    return ForEachCoordinateAround(center, extreme_point, radius_from, radius_to, 0, extreme_point.x, visitor);
+}
+
+/*! \brief Visit cells of the ring, using the cached table when the ring is small enough.
+    \param visitor bool(const Coord&), returns true to stop the enumeration.
+    \return true if the visitor stopped the enumeration.
+*/
+template<typename TVisitor>
+bool ForEachCoordinateAround(RingOffsetCache& cache, const Coord& center, const Coord& extreme_point, uint32_t radius_from, uint32_t radius_to, TVisitor&& visitor)
+{
+    if(const auto* offsets = cache.Get(radius_from, radius_to))
+    {
+        return ForEachCoordinateAround(*offsets, center, extreme_point, visitor);
+    }
+    return ForEachCoordinateAround(center, extreme_point, radius_from, radius_to, visitor);
+}
+
+/*! \brief Visit cells of the ring, using the cached table if it has already been built. Does not modify the cache.
+    \param visitor bool(const Coord&), returns true to stop the enumeration.
+    \return true if the visitor stopped the enumeration.
+*/
+template<typename TVisitor>
+bool ForEachCoordinateAround(const RingOffsetCache& cache, const Coord& center, const Coord& extreme_point, uint32_t radius_from, uint32_t radius_to, TVisitor&& visitor)
+{
+    if(const auto* offsets = cache.Find(radius_from, radius_to))
+    {
+        return ForEachCoordinateAround(*offsets, center, extreme_point, visitor);
+    }
+    return ForEachCoordinateAround(center, extreme_point, radius_from, radius_to, visitor);
+}
+
+//! \brief Get cells of the ring around `center`, clipped by [0, extreme_point].
+inline std::vector<Coord> CoordinatesAround(const Coord& center, const Coord& extreme_point, uint32_t radius_from, uint32_t radius_to)
+{
+    std::vector<Coord> result;
+    ForEachCoordinateAround(center, extreme_point, radius_from, radius_to, [&result](const Coord& coord)
+    {
+        result.push_back(coord);
+        return false;
+    });
+    return result;
+}
+
+}//namespace sw
+
+#endif /*__RINGS_H__*/
@@ -0,0 +1,252 @@
+#ifndef __SIMULATION_H__
+#define __SIMULATION_H__
+#include <cstdio>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <IO/System/CommandFeed.hpp>
+#include <IO/System/BinaryScenario.hpp>
+#include <IO/System/CommandParser.hpp>
+#include <IO/System/EventSink.hpp>
+#include <IO/System/MappedFile.hpp>
+#include <IO/Commands/CreateMap.hpp>
+#include <IO/Commands/SpawnWarrior.hpp>
+#include <IO/Commands/SpawnArcher.hpp>
+#include <IO/Commands/March.hpp>
+#include "actors.h"
+#include "helper.h"
+
+namespace sw
+{
+
+//! \brief Simulates one battle from a command file. Battles share no state and may run on different threads.
+class SimulatingMachine
+{
+public:
+    //! \param sink Sink the events of the battle go to. nullptr drops them.
+    SimulatingMachine(const BattleFieldOptions& options, std::unique_ptr<IEventSink> sink)
+        :   options_(options)
+    {
+        logger_.SetSink(std::move(sink));
+        parser_
+            .add<io::CreateMap>([this](auto command) { Apply(command); })
+            .add<io::SpawnWarrior>([this](auto command) { Apply(command); })
+            .add<io::SpawnArcher>([this](auto command) { Apply(command); })
+            .add<io::March>([this](auto command) { Apply(command); });
+    }
+    /*! \brief Apply all commands of the file, then run the battle until no unit can step further.
+        \param filename Command file or binary scenario, see io::BinaryScenario.
+        \exception std::runtime_error if the file is not found.
+    */
+    void Run(const char* filename)
+    {
+        const MappedFile file(filename);
+        Expected(file.isOpen(), "File not found");
+        FlushOnFailure([&]()
+        {
+            const bool binary = io::BinaryScenario::isBinary(file.text());
+            if(!options_.expected_units)
+            {
+                //Lets the battle field choose its occupancy index knowing how crowded the map gets.
+                options_.expected_units = binary ? io::BinaryScenario::unitCount(file.text()) : CountSpawns(file.text());
+            }
+            if(binary)
+            {
+                io::BinaryScenario::read(file.text(), [this](const auto& command) { Apply(command); });
+            }
+            else
+            {
+                parser_.parse(file.text());
+            }
+            RunTicks();
+        });
+    }
+    /*! \brief Continue a battle from a snapshot written by a checkpoint, see SetCheckpoints.
+        The events of the ticks after the snapshot are the same as the ones the original run logged.
+        \exception std::runtime_error if the file is not found or is not a snapshot written by this build.
+    */
+    void Restore(const char* filename)
+    {
+        Expected(!field_, "Already created");
+        const MappedFile file(filename);
+        Expected(file.isOpen(), "File not found");
+        field_ = RestoreBattleField(file.text(), logger_, options_);
+        FlushOnFailure([&]()
+        {
+            RunTicks();
+        });
+    }
+    /*! \brief Save the state of the battle every `every` ticks of Run or Restore, see IBattleField::Checkpoint.
+        The snapshot is written next to `filename` first, then renamed over it, so the file always holds a whole snapshot.
+        \param every 0 stops checkpoints.
+    */
+    void SetCheckpoints(const std::string& filename, uint64_t every)
+    {
+        checkpoint_file_ = filename;
+        checkpoint_every_ = every;
+    }
+    /*! \brief Write the state hash of the battle after every tick to `filename`, see IBattleField::StateHash.
+        A line per tick: the tick and the hash in hex. Runs behave the same until the first line their files differ in.
+        Must be called before the battle field is created.
+        \exception std::runtime_error if the file cannot be created.
+    */
+    void SetStateHashes(const std::string& filename)
+    {
+        Expected(!field_, "Already created");
+        hashes_.open(filename, std::ios::trunc);
+        Expected(!!hashes_, "Could not create the state hash file");
+        options_.state_hash = true;
+    }
+    /*! \brief Run the battle applying commands as they are read from `input`, see io::CommandFeed.
+        The battle goes on while units can step further or the stream has commands left.
+        A stream is not counted ahead: the occupancy index is chosen from BattleFieldOptions::expected_units as given.
+        Units idle, see BattleFieldOptions::idle_units: a unit spawned now may get its march on a later tick.
+    */
+    void RunStream(std::istream& input)
+    {
+        options_.idle_units = true;
+        io::CommandFeed feed(input, parser_);
+        FlushOnFailure([&]()
+        {
+            feed.applyUntil(logger_.Tick());
+            while(true)
+            {
+                logger_.NextTick();
+                feed.applyUntil(logger_.Tick());
+                const bool steps_more = field_ && field_->DoNextStep();
+                if(field_)
+                {
+                    WriteStateHash();
+                }
+                if(!steps_more && feed.exhausted())
+                {
+                    break;
+                }
+            }
+        });
+    }
+    /*! \brief Profile the ticks of the battle from now on, see TickProfiler. nullptr stops profiling.
+        \param profiler Must outlive the runs.
+    */
+    void SetProfiler(TickProfiler* profiler)
+    {
+        logger_.SetProfiler(profiler);
+    }
+    //! \brief Describe the battle field, empty if it has not been created.
+    BattleFieldDiagnostics Diagnostics() const
+    {
+        return field_ ? field_->Diagnostics() : BattleFieldDiagnostics{};
+    }
+    //! \brief Ticks simulated so far.
+    uint64_t Ticks() const
+    {
+        return logger_.Tick();
+    }
+private:
+    //! \brief Run the battle until no unit can step further.
+    void RunTicks()
+    {
+        //A file without CREATE_MAP fails like any other bad scenario, see RunBatch.
+        Expected(!!field_, "Battle field has not been created");
+        while(true)
+        {
+            logger_.NextTick();
+            const bool steps_more = field_->DoNextStep();
+            WriteStateHash();
+            if(!steps_more)
+            {
+                break;
+            }
+            if(checkpoint_every_ && logger_.Tick() % checkpoint_every_ == 0)
+            {
+                Checkpoint();
+            }
+        }
+    }
+    //! \brief Number of spawn commands in a command file: lines the parser takes for one, without reading their fields.
+    static uint64_t CountSpawns(std::string_view text)
+    {
+        uint64_t count = 0;
+        io::CommandParser::forEachLine(text, [&count](std::string_view line)
+        {
+            std::string_view name;
+            std::string_view fields;
+            if(io::CommandParser::splitLine(line, name, fields) && (name == io::SpawnWarrior::Name || name == io::SpawnArcher::Name))
+            {
+                ++count;
+            }
+        });
+        return count;
+    }
+    void WriteStateHash()
+    {
+        if(!options_.state_hash)
+        {
+            return;
+        }
+        char line[48];
+        const int size = std::snprintf(line, sizeof(line), "%llu %016llx\n",
+            static_cast<unsigned long long>(logger_.Tick()), static_cast<unsigned long long>(field_->StateHash()));
+        hashes_.write(line, size);
+    }
+    void Checkpoint()
+    {
+        field_->Checkpoint(snapshot_);
+        const auto temporary = checkpoint_file_ + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(snapshot_.data(), static_cast<std::streamsize>(snapshot_.size()));
+            Expected(!!out.flush(), "Could not write the checkpoint");
+        }
+        Expected(std::rename(temporary.c_str(), checkpoint_file_.c_str()) == 0, "Could not write the checkpoint");
+    }
+    void Apply(const io::CreateMap& command)
+    {
+        Expected(!field_, "Already created");
+        field_ = CreateBattleField(command, logger_, options_);
+    }
+    //! \brief Apply io::SpawnWarrior or io::SpawnArcher.
+    template<typename TSpawn>
+    void Apply(const TSpawn& command)
+    {
+        Expected(!!field_, "Battle field has not been created");
+        field_->AddUnit(command);
+    }
+    void Apply(const io::March& command)
+    {
+        Expected(!!field_, "Battle field has not been created");
+        field_->MarchTo(command);
+    }
+    template<typename TBody>
+    void FlushOnFailure(TBody&& body)
+    {
+        try
+        {
+            body();
+        }
+        catch (...)
+        {
+            //Events logged before the failure are still printed.
+            logger_.Flush();
+            throw;
+        }
+    }
+private:
+    BattleFieldOptions options_;
+    Logger logger_;
+    io::CommandParser parser_;
+    std::unique_ptr<IBattleField> field_;
+
+    std::string checkpoint_file_;
+    uint64_t checkpoint_every_ = 0;
+    //Memory of the last snapshot, reused by the next one.
+    std::string snapshot_;
+    //State hashes by tick, see SetStateHashes.
+    std::ofstream hashes_;
+};
+
+}//namespace sw
+
+#endif /*__SIMULATION_H__*/
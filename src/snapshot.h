@@ -0,0 +1,264 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <IO/Commands/CreateMap.hpp>
+#include <IO/Commands/SpawnWarrior.hpp>
+#include <IO/Commands/SpawnArcher.hpp>
+#include "helper.h"
+
+namespace sw
+{
+
+/*
+    Snapshot of a battle: its complete state between two ticks, see IBattleField::Checkpoint and RestoreBattleField.
+
+    Records are plain structures of fixed-width integers without padding, written as they lie in memory,
+    so restoring is copying them out of a mapped file and equal states give equal bytes.
+    A snapshot is restored by the build that wrote it, the header checks the layout, and every record is checked
+    against the map as it is read, so a damaged snapshot fails with an error instead of corrupting the battle:
+        SnapshotHeader;
+        SnapshotUnit, `units` times - in the order of slots, i.e. the order units were spawned in;
+        SnapshotCell, `cells` times - the occupancy index: the slot in every occupied cell, in the order of slots.
+    Which units are idle is not saved: all of them step on the first tick after a restore, which logs
+    the same events as skipping the idle ones, see active_set.h.
+*/
+
+struct SnapshotHeader
+{
+    static constexpr char kMagic[4] = { 'S', 'W', 'C', 'P' };
+    static constexpr uint32_t kVersion = 2;
+
+    char magic[4] = {};
+    uint32_t version = 0;
+    //! \brief sizeof(SnapshotUnit) of the build which wrote the snapshot.
+    uint32_t unit_size = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t units = 0;
+    uint64_t cells = 0;
+    //! \brief Tick of the logger the snapshot was taken at.
+    uint64_t tick = 0;
+};
+
+struct SnapshotUnit
+{
+    //! \brief Kind of the unit.
+    enum kind_t : uint32_t
+    {
+        warrior,
+        archer
+    };
+    uint32_t kind = warrior;
+    uint32_t id = 0;
+    //! \brief Spawn cell.
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t hp = 0;
+    uint32_t strength = 0;
+    uint32_t agility = 0;
+    uint32_t range = 0;
+    uint32_t march_ended = 0;
+    uint32_t reserved = 0;
+    PathCursor::State path;
+};
+
+struct SnapshotCell
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t slot = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<SnapshotHeader>);
+static_assert(std::is_trivially_copyable_v<SnapshotUnit>);
+static_assert(std::is_trivially_copyable_v<SnapshotCell>);
+static_assert(std::has_unique_object_representations_v<SnapshotHeader>);
+static_assert(std::has_unique_object_representations_v<SnapshotUnit>);
+static_assert(std::has_unique_object_representations_v<SnapshotCell>);
+
+//! \brief Record of a unit with the stats of its spawn command. hp is the current one.
+inline SnapshotUnit MakeSnapshotUnit(const io::SpawnWarrior& warrior)
+{
+    SnapshotUnit unit;
+    unit.kind = SnapshotUnit::warrior;
+    unit.id = warrior.unitId;
+    unit.x = warrior.x;
+    unit.y = warrior.y;
+    unit.hp = warrior.hp;
+    unit.strength = warrior.strength;
+    return unit;
+}
+inline SnapshotUnit MakeSnapshotUnit(const io::SpawnArcher& archer)
+{
+    SnapshotUnit unit;
+    unit.kind = SnapshotUnit::archer;
+    unit.id = archer.unitId;
+    unit.x = archer.x;
+    unit.y = archer.y;
+    unit.hp = archer.hp;
+    unit.strength = archer.strength;
+    unit.agility = archer.agility;
+    unit.range = archer.range;
+    return unit;
+}
+
+/*! \brief Call `visitor` with the spawn command of the unit, io::SpawnWarrior or io::SpawnArcher.
+    \exception std::runtime_error if the kind is unknown.
+*/
+template<typename TVisitor>
+void WithSpawnCommand(const SnapshotUnit& unit, TVisitor&& visitor)
+{
+    switch(unit.kind)
+    {
+    case SnapshotUnit::warrior:
+    {
+        io::SpawnWarrior warrior;
+        warrior.unitId = unit.id;
+        warrior.x = unit.x;
+        warrior.y = unit.y;
+        warrior.hp = unit.hp;
+        warrior.strength = unit.strength;
+        visitor(warrior);
+        return;
+    }
+    case SnapshotUnit::archer:
+    {
+        io::SpawnArcher archer;
+        archer.unitId = unit.id;
+        archer.x = unit.x;
+        archer.y = unit.y;
+        archer.hp = unit.hp;
+        archer.agility = unit.agility;
+        archer.strength = unit.strength;
+        archer.range = unit.range;
+        visitor(archer);
+        return;
+    }
+    }
+    Expected(false, "Snapshot: unknown unit kind");
+}
+
+//! \brief Writes a snapshot into a string, reusing its memory from one checkpoint to the next.
+class SnapshotWriter
+{
+public:
+    //! \param out Replaced with the snapshot.
+    SnapshotWriter(std::string& out, const io::CreateMap& map, uint64_t tick, uint32_t units)
+        :   out_(out)
+    {
+        header_.width = map.width;
+        header_.height = map.height;
+        header_.tick = tick;
+        header_.units = units;
+        std::memcpy(header_.magic, SnapshotHeader::kMagic, sizeof(header_.magic));
+        header_.version = SnapshotHeader::kVersion;
+        header_.unit_size = sizeof(SnapshotUnit);
+        out_.clear();
+        Append(header_);
+    }
+    //! \brief Add units in the order of their slots, then the cells.
+    void Add(const SnapshotUnit& unit)
+    {
+        Append(unit);
+    }
+    void Add(const Coord& coord, uint32_t slot)
+    {
+        SnapshotCell cell;
+        cell.x = coord.x;
+        cell.y = coord.y;
+        cell.slot = slot;
+        Append(cell);
+        ++header_.cells;
+    }
+    //! \brief Write the number of cells into the header.
+    void Finish()
+    {
+        std::memcpy(out_.data(), &header_, sizeof(header_));
+    }
+private:
+    template<typename TRecord>
+    void Append(const TRecord& record)
+    {
+        out_.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+private:
+    std::string& out_;
+    SnapshotHeader header_;
+};
+
+//! \brief Reads records of a snapshot in place. The data must outlive the reader.
+class SnapshotReader
+{
+public:
+    //! \exception std::runtime_error if the data is not a snapshot written by this build.
+    explicit SnapshotReader(std::string_view data)
+        :   data_(data)
+    {
+        Expected(data_.size() >= sizeof(header_), "Snapshot: bad header");
+        std::memcpy(&header_, data_.data(), sizeof(header_));
+        Expected(std::memcmp(header_.magic, SnapshotHeader::kMagic, sizeof(header_.magic)) == 0, "Snapshot: bad header");
+        Expected(header_.version == SnapshotHeader::kVersion, "Snapshot: unsupported version");
+        Expected(header_.unit_size == sizeof(SnapshotUnit), "Snapshot: written by an incompatible build");
+        const uint64_t cells_offset = sizeof(SnapshotHeader) + uint64_t(header_.units) * sizeof(SnapshotUnit);
+        Expected(cells_offset <= data_.size(), "Snapshot: truncated");
+        const uint64_t cells_size = data_.size() - cells_offset;
+        Expected(cells_size % sizeof(SnapshotCell) == 0 && cells_size / sizeof(SnapshotCell) == header_.cells, "Snapshot: truncated");
+    }
+    const SnapshotHeader& Header() const
+    {
+        return header_;
+    }
+    io::CreateMap Map() const
+    {
+        io::CreateMap map;
+        map.width = header_.width;
+        map.height = header_.height;
+        return map;
+    }
+    /*! \exception std::runtime_error if the spawn cell of the unit is out of the map or its current cell is off its march.
+        MARCH takes any target, so a unit may have walked out of the map towards its target, but not further.
+    */
+    SnapshotUnit Unit(uint32_t slot) const
+    {
+        const auto unit = Read<SnapshotUnit>(sizeof(SnapshotHeader) + uint64_t(slot) * sizeof(SnapshotUnit));
+        Expected(Inside(unit.x, unit.y), "Snapshot: unit out of the map");
+        Expected(!unit.path.valid || (Between(unit.path.x, unit.x, unit.path.end_x) && Between(unit.path.y, unit.y, unit.path.end_y)),
+            "Snapshot: unit off its march");
+        return unit;
+    }
+    //! \exception std::runtime_error if the cell holds an unknown unit. The cell is the one of the unit, see Unit.
+    SnapshotCell Cell(uint64_t index) const
+    {
+        const auto cell = Read<SnapshotCell>(sizeof(SnapshotHeader) + uint64_t(header_.units) * sizeof(SnapshotUnit) + index * sizeof(SnapshotCell));
+        Expected(cell.slot < header_.units, "Snapshot: unknown unit in a cell");
+        return cell;
+    }
+private:
+    bool Inside(uint32_t x, uint32_t y) const
+    {
+        return x < header_.width && y < header_.height;
+    }
+    static bool Between(uint32_t coordinate, uint32_t from, uint32_t to)
+    {
+        return std::min(from, to) <= coordinate && coordinate <= std::max(from, to);
+    }
+    template<typename TRecord>
+    TRecord Read(uint64_t offset) const
+    {
+        TRecord record;
+        std::memcpy(&record, data_.data() + offset, sizeof(record));
+        return record;
+    }
+private:
+    std::string_view data_;
+    SnapshotHeader header_;
+};
+
+}//namespace sw
+
+#endif /*__SNAPSHOT_H__*/
@@ -0,0 +1,58 @@
+#ifndef __STATE_HASH_H__
+#define __STATE_HASH_H__
+#include <cstdint>
+#include <vector>
+#include "helper.h"
+
+namespace sw
+{
+
+/*
+    Rolling hash of the state of a battle: the id, hp and cell of every unit.
+
+    The hash is the sum of a term per unit. A unit which moves or takes damage replaces its term,
+    so the hash follows the battle step by step and is never recomputed from scratch.
+    The sum does not depend on the order the units are updated in: the same state gives the same hash
+    with any engine, so two runs are compared by their hashes tick by tick instead of by their events.
+*/
+class RollingStateHash
+{
+public:
+    //! \brief Set the state of the unit in the slot. The first call for a slot adds the unit.
+    void Set(uint32_t slot, uint32_t id, uint32_t hp, const Coord& cell)
+    {
+        if(slot >= terms_.size())
+        {
+            terms_.resize(slot + 1, 0);
+        }
+        const auto term = Term(id, hp, cell);
+        value_ += term - terms_[slot];
+        terms_[slot] = term;
+    }
+    uint64_t Value() const
+    {
+        return value_;
+    }
+private:
+    //! \brief splitmix64 finalizer: every bit of the input affects every bit of the output.
+    static uint64_t Mix(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+    static uint64_t Term(uint32_t id, uint32_t hp, const Coord& cell)
+    {
+        const uint64_t unit = (static_cast<uint64_t>(id) << 32) | hp;
+        const uint64_t place = (static_cast<uint64_t>(cell.x) << 32) | cell.y;
+        return Mix(Mix(unit) ^ place);
+    }
+private:
+    //Term of each unit by slot.
+    std::vector<uint64_t> terms_;
+    uint64_t value_ = 0;
+};
+
+}//namespace sw
+
+#endif /*__STATE_HASH_H__*/
@@ -0,0 +1,118 @@
+#ifndef __STEP_PLAN_H__
+#define __STEP_PLAN_H__
+#include <cstdint>
+#include <unordered_set>
+#include <algorithm>
+#include "helper.h"
+
+namespace sw
+{
+
+/*
+    Two-phase tick. First every unit plans its step against the field as it was at the start of the tick:
+    the searches for a unit to attack it is going to make are done in parallel and their results recorded.
+    Then units step one after another, in slot order, exactly as in the sequential tick; a search whose
+    square has not been touched by the units stepped before it is answered by the recorded result.
+*/
+
+//! \brief Search for a unit to attack made while planning a step.
+struct PlannedScan
+{
+    Coord center;
+    uint32_t radius_from = 0;
+    uint32_t radius_to = 0;
+    //! \brief Slot of the unit found or kNoSlot.
+    uint32_t found = kNoSlot;
+};
+
+//! \brief Searches made while planning the step of one unit.
+struct StepPlan
+{
+    static constexpr uint8_t kMaxScans = 2;
+
+    PlannedScan scans[kMaxScans];
+    uint8_t count = 0;
+
+    //! \brief Record a search. Searches beyond kMaxScans are not recorded and are repeated when stepping.
+    void Add(const PlannedScan& scan)
+    {
+        if(count < kMaxScans)
+        {
+            scans[count++] = scan;
+        }
+    }
+    //! \brief Get the recorded search with the same arguments. nullptr if there is none.
+    const PlannedScan* Match(const Coord& center, uint32_t radius_from, uint32_t radius_to) const
+    {
+        for(uint8_t i = 0; i < count; ++i)
+        {
+            const auto& scan = scans[i];
+            if(scan.center == center && scan.radius_from == radius_from && scan.radius_to == radius_to)
+            {
+                return &scan;
+            }
+        }
+        return nullptr;
+    }
+};
+
+/*! \brief Cells changed during the tick: their occupant changed or the unit standing there died.
+    Kept as a set of square tiles, so a check covers a whole square of cells at once.
+*/
+class DirtyTiles
+{
+public:
+    static constexpr uint32_t kTileShift = 4;
+
+    void Mark(const Coord& coord)
+    {
+        tiles_.insert(Key(coord.x >> kTileShift, coord.y >> kTileShift));
+    }
+    void Clear()
+    {
+        tiles_.clear();
+    }
+    //! \brief Check if any changed cell may lie within `radius` of `center` by Chebyshev distance.
+    bool Touches(const Coord& center, uint32_t radius) const
+    {
+        if(tiles_.empty())
+        {
+            return false;
+        }
+        const uint64_t x_from = center.x > radius ? (center.x - radius) >> kTileShift : 0;
+        const uint64_t y_from = center.y > radius ? (center.y - radius) >> kTileShift : 0;
+        const uint64_t x_to = (static_cast<uint64_t>(center.x) + radius) >> kTileShift;
+        const uint64_t y_to = (static_cast<uint64_t>(center.y) + radius) >> kTileShift;
+        if((x_to - x_from + 1) * (y_to - y_from + 1) > tiles_.size())
+        {
+            return std::any_of(tiles_.begin(), tiles_.end(), [&](uint64_t key)
+            {
+                const auto x = key >> 32;
+                const auto y = key & 0xFFFFFFFFu;
+                return x >= x_from && x <= x_to && y >= y_from && y <= y_to;
+            });
+        }
+        for(auto x = x_from; x <= x_to; ++x)
+        {
+            for(auto y = y_from; y <= y_to; ++y)
+            {
+                if(tiles_.count(Key(x, y)))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+private:
+    static uint64_t Key(uint64_t x, uint64_t y)
+    {
+        return (x << 32) | y;
+    }
+private:
+    std::unordered_set<uint64_t> tiles_;
+};
+
+}//namespace sw
+
+#endif /*__STEP_PLAN_H__*/
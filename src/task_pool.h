@@ -0,0 +1,138 @@
+#ifndef __TASK_POOL_H__
+#define __TASK_POOL_H__
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sw
+{
+
+/*! \brief Fixed set of threads running loops over an index range.
+    Threads take chunks of the range from a shared counter until it is exhausted, so a thread that finishes
+    its chunks early takes the ones others have not reached yet. The calling thread works too.
+*/
+class TaskPool
+{
+public:
+    //! \brief Start `threads` - 1 worker threads; the caller is the last one.
+    explicit TaskPool(uint32_t threads)
+    {
+        for(uint32_t i = 1; i < threads; ++i)
+        {
+            workers_.emplace_back([this] { Work(); });
+        }
+    }
+    ~TaskPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for(auto& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    //! \brief Threads of the pool, the caller included.
+    uint32_t Threads() const
+    {
+        return static_cast<uint32_t>(workers_.size() + 1);
+    }
+
+    /*! \brief Call `task(begin, end)` for chunks covering [0, count) and wait until all are done.
+        \exception The first exception thrown by a task, after all threads have stopped.
+    */
+    void ForEach(uint32_t count, uint32_t chunk, const std::function<void(uint32_t, uint32_t)>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            count_ = count;
+            chunk_ = chunk ? chunk : 1;
+            next_.store(0, std::memory_order_relaxed);
+            busy_ = static_cast<uint32_t>(workers_.size());
+            error_ = nullptr;
+            ++generation_;
+        }
+        start_.notify_all();
+        RunChunks();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return !busy_; });
+        task_ = nullptr;
+        if(error_)
+        {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    void RunChunks()
+    {
+        try
+        {
+            for(auto begin = next_.fetch_add(chunk_); begin < count_; begin = next_.fetch_add(chunk_))
+            {
+                (*task_)(begin, std::min(begin + chunk_, count_));
+            }
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(!error_)
+            {
+                error_ = std::current_exception();
+            }
+            next_.store(count_);
+        }
+    }
+    void Work()
+    {
+        uint64_t seen = 0;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+                if(stop_)
+                {
+                    return;
+                }
+                seen = generation_;
+            }
+            RunChunks();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                --busy_;
+            }
+            done_.notify_one();
+        }
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(uint32_t, uint32_t)>* task_ = nullptr;
+    uint32_t count_ = 0;
+    uint32_t chunk_ = 1;
+    std::atomic<uint32_t> next_{0};
+    uint32_t busy_ = 0;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+};
+
+}//namespace sw
+
+#endif /*__TASK_POOL_H__*/
@@ -0,0 +1,268 @@
+#ifndef __UNIT_SCAN_H__
+#define __UNIT_SCAN_H__
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "helper.h"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace sw
+{
+
+/*
+    Brute-force targeting: instead of walking the cells of a ring, test every living unit against it.
+
+    Walking a ring of radius r looks up about 4r² cells, testing the units costs the same for any radius.
+    The cells are walked by x, then by y, so the unit the walk meets first is the living unit in the ring
+    with the least x, then the least y: the units are reduced to that one with SIMD, 8 lanes with AVX2,
+    4 with SSE2, one at a time otherwise.
+
+    Positions are kept packed by slot, padded with dead lanes to a whole number of vectors.
+    The occupancy index shows one unit per cell, so the unit found is only the target
+    if the index shows it in its cell; see UnitScanner::Find.
+*/
+
+//! \brief Arrays of the units by slot. `live` is ~0 for a living unit, 0 for a dead one or padding.
+struct PackedUnits
+{
+    const uint32_t* xs = nullptr;
+    const uint32_t* ys = nullptr;
+    const uint32_t* live = nullptr;
+    //! \brief Multiple of UnitScanner::kPadding.
+    size_t count = 0;
+};
+
+//! \brief First living unit of the ring in the order of the cell walk, one unit at a time. kNoSlot if none.
+inline uint32_t ScanRingScalar(const PackedUnits& units, const Coord& center, uint32_t radius_from, uint32_t radius_to)
+{
+    uint32_t found = kNoSlot;
+    uint64_t best = ~uint64_t();
+    for(size_t slot = 0; slot < units.count; ++slot)
+    {
+        const auto x = units.xs[slot];
+        const auto y = units.ys[slot];
+        const auto dx = x > center.x ? x - center.x : center.x - x;
+        const auto dy = y > center.y ? y - center.y : center.y - y;
+        const auto distance = std::max(dx, dy);
+        const uint64_t key = (static_cast<uint64_t>(x) << 32) | y;
+        if(units.live[slot] && distance >= radius_from && distance <= radius_to && key < best)
+        {
+            best = key;
+            found = static_cast<uint32_t>(slot);
+        }
+    }
+    return found;
+}
+
+//! \brief Pick the least (x, y) of the lanes, then the least slot. Lanes hold coordinates with the sign bit flipped.
+inline uint32_t ReduceLanes(const uint32_t* xs, const uint32_t* ys, const uint32_t* slots, size_t lanes)
+{
+    uint32_t found = kNoSlot;
+    uint64_t best = ~uint64_t();
+    for(size_t lane = 0; lane < lanes; ++lane)
+    {
+        if(slots[lane] == kNoSlot)
+        {
+            continue;
+        }
+        const uint64_t key = (static_cast<uint64_t>(xs[lane] ^ 0x80000000u) << 32) | (ys[lane] ^ 0x80000000u);
+        if(key < best || (key == best && slots[lane] < found))
+        {
+            best = key;
+            found = slots[lane];
+        }
+    }
+    return found;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+//! \brief ScanRingScalar with SSE2, 4 units at a time. Unsigned comparisons are made signed by flipping the sign bit.
+inline uint32_t ScanRingSse2(const PackedUnits& units, const Coord& center, uint32_t radius_from, uint32_t radius_to)
+{
+    const __m128i sign = _mm_set1_epi32(INT32_MIN);
+    const auto greater = [sign](__m128i a, __m128i b)
+    {
+        return _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+    };
+    const auto distance = [&greater](__m128i a, __m128i b)
+    {
+        const __m128i a_greater = greater(a, b);
+        return _mm_or_si128(_mm_and_si128(a_greater, _mm_sub_epi32(a, b)), _mm_andnot_si128(a_greater, _mm_sub_epi32(b, a)));
+    };
+    const __m128i cx = _mm_set1_epi32(static_cast<int32_t>(center.x));
+    const __m128i cy = _mm_set1_epi32(static_cast<int32_t>(center.y));
+    const __m128i from = _mm_set1_epi32(static_cast<int32_t>(radius_from));
+    const __m128i to = _mm_set1_epi32(static_cast<int32_t>(radius_to));
+    const __m128i step = _mm_set1_epi32(4);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i best_x = _mm_set1_epi32(INT32_MAX);
+    __m128i best_y = _mm_set1_epi32(INT32_MAX);
+    __m128i best_slot = _mm_set1_epi32(-1);
+    for(size_t slot = 0; slot < units.count; slot += 4)
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units.xs + slot));
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units.ys + slot));
+        const __m128i live = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units.live + slot));
+        const __m128i dx = distance(x, cx);
+        const __m128i dy = distance(y, cy);
+        const __m128i dx_greater = greater(dx, dy);
+        const __m128i d = _mm_or_si128(_mm_and_si128(dx_greater, dx), _mm_andnot_si128(dx_greater, dy));
+        const __m128i outside = _mm_or_si128(greater(from, d), greater(d, to));
+        const __m128i signed_x = _mm_xor_si128(x, sign);
+        const __m128i signed_y = _mm_xor_si128(y, sign);
+        const __m128i better = _mm_or_si128(_mm_cmplt_epi32(signed_x, best_x),
+            _mm_and_si128(_mm_cmpeq_epi32(signed_x, best_x), _mm_cmplt_epi32(signed_y, best_y)));
+        const __m128i update = _mm_andnot_si128(outside, _mm_and_si128(live, better));
+        best_x = _mm_or_si128(_mm_and_si128(update, signed_x), _mm_andnot_si128(update, best_x));
+        best_y = _mm_or_si128(_mm_and_si128(update, signed_y), _mm_andnot_si128(update, best_y));
+        best_slot = _mm_or_si128(_mm_and_si128(update, index), _mm_andnot_si128(update, best_slot));
+        index = _mm_add_epi32(index, step);
+    }
+    alignas(16) uint32_t xs[4], ys[4], slots[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(xs), best_x);
+    _mm_store_si128(reinterpret_cast<__m128i*>(ys), best_y);
+    _mm_store_si128(reinterpret_cast<__m128i*>(slots), best_slot);
+    return ReduceLanes(xs, ys, slots, 4);
+}
+#endif
+
+#if defined(__AVX2__)
+//! \brief ScanRingScalar with AVX2, 8 units at a time.
+inline uint32_t ScanRingAvx2(const PackedUnits& units, const Coord& center, uint32_t radius_from, uint32_t radius_to)
+{
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    const __m256i cx = _mm256_set1_epi32(static_cast<int32_t>(center.x));
+    const __m256i cy = _mm256_set1_epi32(static_cast<int32_t>(center.y));
+    const __m256i from = _mm256_set1_epi32(static_cast<int32_t>(radius_from));
+    const __m256i to = _mm256_set1_epi32(static_cast<int32_t>(radius_to));
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i best_x = _mm256_set1_epi32(INT32_MAX);
+    __m256i best_y = _mm256_set1_epi32(INT32_MAX);
+    __m256i best_slot = _mm256_set1_epi32(-1);
+    for(size_t slot = 0; slot < units.count; slot += 8)
+    {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(units.xs + slot));
+        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(units.ys + slot));
+        const __m256i live = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(units.live + slot));
+        const __m256i dx = _mm256_sub_epi32(_mm256_max_epu32(x, cx), _mm256_min_epu32(x, cx));
+        const __m256i dy = _mm256_sub_epi32(_mm256_max_epu32(y, cy), _mm256_min_epu32(y, cy));
+        const __m256i d = _mm256_max_epu32(dx, dy);
+        const __m256i inside = _mm256_and_si256(
+            _mm256_cmpeq_epi32(_mm256_max_epu32(d, from), d),
+            _mm256_cmpeq_epi32(_mm256_min_epu32(d, to), d));
+        const __m256i signed_x = _mm256_xor_si256(x, sign);
+        const __m256i signed_y = _mm256_xor_si256(y, sign);
+        const __m256i better = _mm256_or_si256(_mm256_cmpgt_epi32(best_x, signed_x),
+            _mm256_and_si256(_mm256_cmpeq_epi32(signed_x, best_x), _mm256_cmpgt_epi32(best_y, signed_y)));
+        const __m256i update = _mm256_and_si256(_mm256_and_si256(inside, live), better);
+        best_x = _mm256_blendv_epi8(best_x, signed_x, update);
+        best_y = _mm256_blendv_epi8(best_y, signed_y, update);
+        best_slot = _mm256_blendv_epi8(best_slot, index, update);
+        index = _mm256_add_epi32(index, step);
+    }
+    alignas(32) uint32_t xs[8], ys[8], slots[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(xs), best_x);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(ys), best_y);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(slots), best_slot);
+    return ReduceLanes(xs, ys, slots, 8);
+}
+#endif
+
+//! \brief The widest kernel compiled in, see SW_AVX2.
+inline uint32_t ScanRing(const PackedUnits& units, const Coord& center, uint32_t radius_from, uint32_t radius_to)
+{
+#if defined(__AVX2__)
+    return ScanRingAvx2(units, center, radius_from, radius_to);
+#elif defined(__SSE2__) || defined(_M_X64)
+    return ScanRingSse2(units, center, radius_from, radius_to);
+#else
+    return ScanRingScalar(units, center, radius_from, radius_to);
+#endif
+}
+
+//! \brief Packed positions of the units of a battle field, kept up to date as units step.
+class UnitScanner
+{
+public:
+    //! \brief Slots are padded to a multiple of the widest vector.
+    static constexpr size_t kPadding = 8;
+    //! \brief Cells of a ring looked up in the time one unit is tested by the kernel compiled in, see Prefer.
+#if defined(__AVX2__)
+    static constexpr uint64_t kCellsPerUnit = 1;
+#else
+    static constexpr uint64_t kCellsPerUnit = 2;
+#endif
+
+    //! \brief Set the cell of the unit in the slot and whether it is alive. The first call for a slot adds the unit.
+    void Set(uint32_t slot, const Coord& cell, bool alive)
+    {
+        if(slot >= xs_.size())
+        {
+            const auto size = (static_cast<size_t>(slot) / kPadding + 1) * kPadding;
+            xs_.resize(size, 0);
+            ys_.resize(size, 0);
+            live_.resize(size, 0);
+        }
+        xs_[slot] = cell.x;
+        ys_[slot] = cell.y;
+        const uint32_t live = alive ? ~uint32_t() : 0;
+        living_ += (live && !live_[slot]);
+        living_ -= (!live && live_[slot]);
+        live_[slot] = live;
+    }
+    //! \brief Living units.
+    uint32_t Living() const
+    {
+        return living_;
+    }
+    /*! \brief Check if testing every unit is cheaper than walking the cells of the ring, which are at most
+        the square of side 2 * radius_to + 1 clipped by the map.
+        \param extreme_point The last cell of the map.
+    */
+    bool Prefer(const Coord& center, const Coord& extreme_point, uint32_t radius_to) const
+    {
+        const auto side = [radius_to](uint32_t c, uint32_t extreme)
+        {
+            const uint64_t low = c > radius_to ? c - radius_to : 0;
+            const uint64_t high = std::min<uint64_t>(static_cast<uint64_t>(c) + radius_to, extreme);
+            return high - low + 1;
+        };
+        const auto x_cells = side(center.x, extreme_point.x);
+        const auto y_cells = side(center.y, extreme_point.y);
+        const uint64_t cost = xs_.size() * kCellsPerUnit;
+        //A side larger than the cost would overflow the product.
+        return x_cells > cost || x_cells * y_cells > cost;
+    }
+    /*! \brief Slot of the living unit in the ring with the least x, then the least y. kNoSlot if none.
+        The walk of the cells meets it first if the occupancy index shows it in its cell, see Cell.
+    */
+    uint32_t Find(const Coord& center, uint32_t radius_from, uint32_t radius_to) const
+    {
+        if(radius_from > radius_to || !living_)
+        {
+            return kNoSlot;
+        }
+        return ScanRing(Units(), center, radius_from, radius_to);
+    }
+    Coord Cell(uint32_t slot) const
+    {
+        return { xs_[slot], ys_[slot] };
+    }
+    PackedUnits Units() const
+    {
+        return { xs_.data(), ys_.data(), live_.data(), xs_.size() };
+    }
+private:
+    std::vector<uint32_t> xs_;
+    std::vector<uint32_t> ys_;
+    std::vector<uint32_t> live_;
+    uint32_t living_ = 0;
+};
+
+}//namespace sw
+
+#endif /*__UNIT_SCAN_H__*/
@@ -0,0 +1,22 @@
+# Generates scenarios of every layout and compiles them: the compiler rejects a cell used twice.
+# Expects GENERATE, SCENARIO and WORK_DIR.
+foreach(layout uniform blob armies)
+    foreach(size "2;10" "3;3" "64;64")
+        list(GET size 0 width)
+        list(GET size 1 height)
+        set(text "${WORK_DIR}/generated_${layout}_${width}x${height}.txt")
+        execute_process(
+            COMMAND ${GENERATE} --width=${width} --height=${height} --warriors=3 --archers=3 --layout=${layout} --out=${text}
+            RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "sw_generate failed for ${layout} ${width}x${height}")
+        endif()
+        execute_process(
+            COMMAND ${SCENARIO} compile ${text} ${text}.bin
+            RESULT_VARIABLE result
+            ERROR_VARIABLE error)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${layout} ${width}x${height}: ${error}")
+        endif()
+    endforeach()
+endforeach()
@@ -0,0 +1,446 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "actors.h"
+#include "actors_internal.h"
+#include "helper.h"
+#include "id_index.h"
+#include "occupancy.h"
+#include "occupancy_bits.h"
+#include "rings.h"
+#include "unit_scan.h"
+
+//Microbenchmarks of the geometry and targeting kernels. Results are printed as JSON.
+namespace
+{
+	using namespace sw;
+
+	//! \brief Keeps a result alive so the compiler does not drop the work producing it.
+	volatile uint64_t sink;
+
+	struct Settings
+	{
+		double minSeconds = 0.2;
+		std::string filter;
+	};
+
+	struct Param
+	{
+		std::string name;
+		double value;
+	};
+
+	class Bench {
+	private:
+		const Settings& _settings;
+		std::ostringstream _results;
+		bool _first = true;
+
+	public:
+		explicit Bench(const Settings& settings) :
+			_settings(settings)
+		{
+		}
+
+		/*! \brief Time `operation` until it has run for the minimum time.
+			\param operation uint64_t(), returns anything derived from its work.
+		*/
+		template <class TOperation>
+		void run(const std::string& name, const std::vector<Param>& params, TOperation&& operation)
+		{
+			if (!_settings.filter.empty() && name.find(_settings.filter) == std::string::npos)
+				return;
+			using Clock = std::chrono::steady_clock;
+			uint64_t iterations = 0;
+			uint64_t batch = 1;
+			double seconds = 0;
+			uint64_t checksum = 0;
+			while (seconds < _settings.minSeconds)
+			{
+				const auto start = Clock::now();
+				for (uint64_t i = 0; i < batch; ++i)
+					checksum += operation();
+				seconds += std::chrono::duration<double>(Clock::now() - start).count();
+				iterations += batch;
+				batch *= 2;
+			}
+			sink = checksum;
+
+			_results << (_first ? "\n" : ",\n") << "    {\"name\": \"" << name << "\", \"params\": {";
+			for (size_t i = 0; i < params.size(); ++i)
+				_results << (i ? ", " : "") << "\"" << params[i].name << "\": " << params[i].value;
+			_results << "}, \"iterations\": " << iterations << ", \"ns_per_op\": " << seconds * 1e9 / iterations << "}";
+			_first = false;
+		}
+
+		std::string json() const
+		{
+			return "{\n  \"benchmarks\": [" + _results.str() + "\n  ]\n}\n";
+		}
+	};
+
+	/*! \brief The geometry the battle field used before rings.h, benched as legacy_cells_of_levels, the baseline of ForEachCoordinateAround.
+		Offsets of the rings of radius [levelFrom, levelTo] around (0, 0), gathered into a set.
+	*/
+	std::set<std::pair<int64_t, int64_t>> cellsOfLevels(int64_t levelFrom, int64_t levelTo)
+	{
+		std::set<std::pair<int64_t, int64_t>> cells;
+		for (auto level = levelFrom; level <= levelTo; ++level)
+		{
+			for (int64_t i = 0; i <= level; ++i)
+			{
+				cells.emplace(i, level);
+				cells.emplace(level, i);
+			}
+		}
+		std::set<std::pair<int64_t, int64_t>> mirrored;
+		for (const auto& [x, y] : cells)
+		{
+			mirrored.emplace(-x, y);
+			mirrored.emplace(x, -y);
+			mirrored.emplace(-x, -y);
+		}
+		cells.insert(mirrored.cbegin(), mirrored.cend());
+		return cells;
+	}
+
+	//! \brief Cells of the line between two cells, all at once: benched as legacy_bresenham, the baseline of PathCursor.
+	std::vector<Coord> bresenham(const Coord& start, const Coord& end)
+	{
+		int64_t x = start.x;
+		int64_t y = start.y;
+		const int64_t dx = std::abs(int64_t(end.x) - x);
+		const int64_t dy = std::abs(int64_t(end.y) - y);
+		const int64_t sx = x < end.x ? 1 : -1;
+		const int64_t sy = y < end.y ? 1 : -1;
+		int64_t err = dx - dy;
+		std::vector<Coord> result;
+		while (true)
+		{
+			result.emplace_back(static_cast<uint32_t>(x), static_cast<uint32_t>(y));
+			if (x == end.x && y == end.y)
+				break;
+			const int64_t err2 = err * 2;
+			if (err2 > -dy)
+			{
+				err -= dy;
+				x += sx;
+			}
+			if (err2 < dx)
+			{
+				err += dx;
+				y += sy;
+			}
+		}
+		return result;
+	}
+
+	//! \brief Battle field of `size` x `size` cells, `density` of them occupied by warriors.
+	std::unique_ptr<IBattleField> makeField(Logger& logger, uint32_t size, double density, std::vector<Coord>& units)
+	{
+		io::CreateMap map;
+		map.width = size;
+		map.height = size;
+		auto field = CreateBattleField(map, logger);
+		std::mt19937 random(size);
+		std::bernoulli_distribution occupied(density);
+		uint32_t id = 1;
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				if (!occupied(random))
+					continue;
+				io::SpawnWarrior warrior;
+				warrior.unitId = id++;
+				warrior.x = x;
+				warrior.y = y;
+				warrior.hp = 10;
+				warrior.strength = 1;
+				field->AddUnit(warrior);
+				units.emplace_back(x, y);
+			}
+		}
+		return field;
+	}
+
+	void geometry(Bench& bench)
+	{
+		for (const uint32_t radius : { 1u, 2u, 5u, 10u, 32u, 64u })
+		{
+			const std::vector<Param> params { { "radius", static_cast<double>(radius) } };
+			bench.run("legacy_cells_of_levels", params, [radius] { return cellsOfLevels(0, radius).size(); });
+			const Coord center(500, 500);
+			const Coord extreme(999, 999);
+			bench.run("CoordinatesAround", params, [&] { return CoordinatesAround(center, extreme, 1, radius).size(); });
+			RingOffsetCache rings;
+			bench.run("ForEachCoordinateAround", params, [&]
+			{
+				uint64_t sum = 0;
+				ForEachCoordinateAround(rings, center, extreme, 1, radius, [&sum](const Coord& coord)
+				{
+					sum += coord.x ^ coord.y;
+					return false;
+				});
+				return sum;
+			});
+		}
+		for (const uint32_t length : { 10u, 100u, 1000u, 10000u })
+		{
+			const std::vector<Param> params { { "length", static_cast<double>(length) } };
+			const Coord start(0, 0);
+			const Coord end(length, length / 3);
+			bench.run("legacy_bresenham", params, [&] { return bresenham(start, end).size(); });
+			bench.run("PathCursor", params, [&]
+			{
+				PathCursor path(start, end);
+				uint64_t steps = 0;
+				for (; !path.AtEnd(); path.Advance())
+					++steps;
+				return steps + path.Current().x;
+			});
+		}
+	}
+
+	void targeting(Bench& bench)
+	{
+		Logger logger;
+		logger.SetSink(nullptr);
+		for (const uint32_t size : { 64u, 512u, 2048u })
+		{
+			for (const double density : { 0.01, 0.1, 0.5 })
+			{
+				std::vector<Coord> units;
+				auto field = makeField(logger, size, density, units);
+				auto* internal = dynamic_cast<IBattleFieldInternal*>(field.get());
+				if (!internal || units.empty())
+					continue;
+				const Coord extreme(size - 1, size - 1);
+				for (const uint32_t radius : { 1u, 5u, 32u })
+				{
+					const std::vector<Param> params {
+						{ "map", static_cast<double>(size) }, { "density", density }, { "radius", static_cast<double>(radius) } };
+					size_t next = 0;
+					bench.run("BattleField::GetUnitToAttack", params, [&]
+					{
+						const auto& center = units[next++ % units.size()];
+						return reinterpret_cast<uintptr_t>(internal->GetUnitToAttack(CoordinatesAround(center, extreme, 1, radius)));
+					});
+					bench.run("BattleField::FindUnitToAttack", params, [&]
+					{
+						const auto& center = units[next++ % units.size()];
+						return reinterpret_cast<uintptr_t>(internal->FindUnitToAttack(center, 1, radius));
+					});
+				}
+			}
+		}
+	}
+
+	void scanning(Bench& bench)
+	{
+		//Units spread over a window of the map: the cost of a kernel depends on the units, not on the radius.
+		for (const uint32_t count : { 1000u, 10000u, 100000u })
+		{
+			UnitScanner scanner;
+			std::mt19937 random(count);
+			const uint32_t window = 4096;
+			for (uint32_t slot = 0; slot < count; ++slot)
+				scanner.Set(slot, Coord(random() % window, random() % window), true);
+			const auto units = scanner.Units();
+			const Coord center(window / 2, window / 2);
+			const std::vector<Param> params { { "units", static_cast<double>(count) } };
+			bench.run("ScanRingScalar", params, [&] { return ScanRingScalar(units, center, 2, 8); });
+#if defined(__SSE2__) || defined(_M_X64)
+			bench.run("ScanRingSse2", params, [&] { return ScanRingSse2(units, center, 2, 8); });
+#endif
+#if defined(__AVX2__)
+			bench.run("ScanRingAvx2", params, [&] { return ScanRingAvx2(units, center, 2, 8); });
+#endif
+		}
+	}
+
+	void bitboard(Bench& bench)
+	{
+		//Rings around random cells walked cell by cell and with their empty strips skipped, the units marked in the bitboard.
+		const uint32_t size = 2048;
+		const Coord extreme(size - 1, size - 1);
+		for (const double density : { 0.0001, 0.001, 0.01 })
+		{
+			OccupancyBits bits(size, size);
+			std::mt19937 random(size);
+			std::bernoulli_distribution occupied(density);
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				for (uint32_t y = 0; y < size; ++y)
+				{
+					if (occupied(random))
+						bits.Set(Coord(x, y), true);
+				}
+			}
+			std::vector<Coord> centers;
+			for (uint32_t i = 0; i < 4096; ++i)
+				centers.emplace_back(random() % size, random() % size);
+			for (const uint32_t radius : { 5u, 32u })
+			{
+				const std::vector<Param> params { { "density", density }, { "radius", static_cast<double>(radius) } };
+				size_t next = 0;
+				const auto visitor = [&bits](const Coord& coord) { return bits.Any(coord.x, coord.x, coord.y, coord.y); };
+				bench.run("OccupancyBits::WalkAll", params, [&]
+				{
+					return ForEachCoordinateAround(centers[next++ % centers.size()], extreme, 1, radius, visitor);
+				});
+				bench.run("OccupancyBits::WalkMarked", params, [&]
+				{
+					return ForEachMarkedAround(bits, centers[next++ % centers.size()], extreme, 1, radius, visitor);
+				});
+			}
+		}
+	}
+
+	void occupancy(Bench& bench)
+	{
+		//Units spread over a window of the map, as a battle on a huge map is.
+		const uint32_t window = 2048;
+		for (const double density : { 0.01, 0.1 })
+		{
+			std::vector<Coord> units;
+			std::mt19937 random(window);
+			std::bernoulli_distribution occupied(density);
+			for (uint32_t x = 0; x < window; ++x)
+			{
+				for (uint32_t y = 0; y < window; ++y)
+				{
+					if (occupied(random))
+						units.emplace_back(x, y);
+				}
+			}
+			std::shuffle(units.begin(), units.end(), random);
+			for (const auto layout : { OccupancyLayout::flat, OccupancyLayout::tiled, OccupancyLayout::sparse })
+			{
+				WithOccupancy(layout, [&](auto tag)
+				{
+					typename decltype(tag)::type positions(window, window);
+					for (uint32_t slot = 0; slot < units.size(); ++slot)
+						positions.Occupy(units[slot], slot);
+					const std::vector<Param> params {
+						{ "density", density }, { "units", static_cast<double>(units.size()) }, { "memory", static_cast<double>(positions.MemoryUsage()) } };
+					const std::string name = std::string("Occupancy::") + OccupancyLayoutName(layout);
+					size_t next = 0;
+					bench.run(name + "::Find", params, [&]
+					{
+						const auto& unit = units[next++ % units.size()];
+						return positions.Find(Coord(unit.x ^ 1, unit.y));
+					});
+					bench.run(name + "::Step", params, [&]
+					{
+						const auto slot = static_cast<uint32_t>(next++ % units.size());
+						positions.Vacate(units[slot]);
+						positions.Occupy(units[slot], slot);
+						return slot;
+					});
+				});
+			}
+		}
+	}
+
+	void checkpoints(Bench& bench)
+	{
+		Logger logger;
+		logger.SetSink(nullptr);
+		for (const uint32_t size : { 512u, 2048u })
+		{
+			for (const double density : { 0.01, 0.1 })
+			{
+				std::vector<Coord> units;
+				auto field = makeField(logger, size, density, units);
+				const std::vector<Param> params {
+					{ "map", static_cast<double>(size) }, { "density", density }, { "units", static_cast<double>(units.size()) } };
+				std::string snapshot;
+				field->Checkpoint(snapshot);
+				bench.run("IBattleField::Checkpoint", params, [&]
+				{
+					field->Checkpoint(snapshot);
+					return snapshot.size();
+				});
+				bench.run("RestoreBattleField", params, [&]
+				{
+					Logger restored;
+					restored.SetSink(nullptr);
+					return reinterpret_cast<uintptr_t>(RestoreBattleField(snapshot, restored).get());
+				});
+			}
+		}
+	}
+
+	void storage(Bench& bench)
+	{
+		//The id lookup behind UnitStorage::Get and the MARCH command; the array access after it is not timed.
+		for (const uint32_t count : { 1000u, 100000u, 1000000u })
+		{
+			for (const bool sparse : { false, true })
+			{
+				IdIndex index;
+				std::vector<uint32_t> ids;
+				std::mt19937 random(count);
+				for (uint32_t slot = 0; slot < count; ++slot)
+				{
+					const auto id = sparse ? static_cast<uint32_t>(random()) : slot + 1;
+					if (index.Insert(id, slot))
+						ids.push_back(id);
+				}
+				std::shuffle(ids.begin(), ids.end(), random);
+				const std::vector<Param> params { { "units", static_cast<double>(count) }, { "sparse_ids", sparse ? 1.0 : 0.0 } };
+				size_t next = 0;
+				bench.run("IdIndex::Find", params, [&] { return index.Find(ids[next++ % ids.size()]); });
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	std::string output;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg.rfind("--filter=", 0) == 0)
+			settings.filter = arg.substr(std::string("--filter=").size());
+		else if (arg.rfind("--min-time=", 0) == 0)
+			settings.minSeconds = std::stod(arg.substr(std::string("--min-time=").size()));
+		else if (arg.rfind("--out=", 0) == 0)
+			output = arg.substr(std::string("--out=").size());
+		else
+		{
+			std::cerr << "Usage: sw_bench [--filter=NAME] [--min-time=SECONDS] [--out=FILE]" << std::endl;
+			return 2;
+		}
+	}
+
+	Bench bench(settings);
+	geometry(bench);
+	targeting(bench);
+	scanning(bench);
+	bitboard(bench);
+	occupancy(bench);
+	checkpoints(bench);
+	storage(bench);
+
+	if (output.empty())
+	{
+		std::cout << bench.json();
+		return 0;
+	}
+	std::ofstream file(output, std::ios::trunc);
+	file << bench.json();
+	return file ? 0 : 1;
+}
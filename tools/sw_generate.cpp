@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <IO/System/BinaryScenario.hpp>
+
+/*
+	Generator of large command files. Every unit is computed from the seed and its number alone,
+	so the output is streamed: spawns first, then marches, without keeping the units in memory.
+*/
+namespace
+{
+	using namespace sw;
+
+	//! \brief Stateless mixing of 64 bits, the finalizer of SplitMix64.
+	uint64_t mix(uint64_t value)
+	{
+		value += 0x9E3779B97F4A7C15ull;
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+
+	//! \brief Random numbers of one unit, reproducible from the seed and the unit number.
+	class UnitRandom {
+	private:
+		uint64_t _state;
+
+	public:
+		UnitRandom(uint64_t seed, uint64_t unit, uint64_t stream) :
+			_state(mix(seed ^ mix(unit * 4 + stream)))
+		{
+		}
+
+		uint64_t next()
+		{
+			_state = mix(_state);
+			return _state;
+		}
+
+		//! \brief Uniform in [0, 1).
+		double real()
+		{
+			return static_cast<double>(next() >> 11) * 0x1.0p-53;
+		}
+
+		//! \brief Uniform in [0, bound).
+		uint64_t below(uint64_t bound)
+		{
+			return bound ? next() % bound : 0;
+		}
+	};
+
+	/*! \brief Pseudo-random permutation of [0, size): a Feistel network on the smallest even number of bits covering
+		the range, walking the cycle until the value falls into it. Picks distinct cells without remembering them.
+	*/
+	class Permutation {
+	private:
+		uint64_t _size;
+		uint64_t _seed;
+		unsigned _halfBits;
+		uint64_t _halfMask;
+
+		uint64_t encrypt(uint64_t value) const
+		{
+			auto left = value >> _halfBits;
+			auto right = value & _halfMask;
+			for (uint64_t round = 0; round < 4; ++round)
+			{
+				const auto next = left ^ (mix(right ^ _seed ^ (round << 56)) & _halfMask);
+				left = right;
+				right = next;
+			}
+			return (left << _halfBits) | right;
+		}
+
+	public:
+		Permutation(uint64_t size, uint64_t seed) :
+			_size(size),
+			_seed(mix(seed))
+		{
+			unsigned bits = 2;
+			while (bits < 64 && (1ull << bits) < size)
+				bits += 2;
+			_halfBits = bits / 2;
+			_halfMask = (1ull << _halfBits) - 1;
+		}
+
+		uint64_t operator()(uint64_t index) const
+		{
+			auto value = encrypt(index);
+			while (value >= _size)
+				value = encrypt(value);
+			return value;
+		}
+	};
+
+	//! \brief Distribution of a unit stat: "uniform:MIN:MAX" or "normal:MEAN:STDDEV", clipped to [minimum, UINT32_MAX].
+	struct Distribution
+	{
+		bool normal = false;
+		double a = 1;
+		double b = 10;
+
+		static Distribution parse(const std::string& text)
+		{
+			Distribution result;
+			const auto first = text.find(':');
+			const auto second = text.find(':', first == std::string::npos ? first : first + 1);
+			if (first == std::string::npos || second == std::string::npos)
+				throw std::runtime_error("Malformed distribution: " + text);
+			const auto kind = text.substr(0, first);
+			if (kind != "uniform" && kind != "normal")
+				throw std::runtime_error("Unknown distribution: " + kind);
+			result.normal = kind == "normal";
+			result.a = std::stod(text.substr(first + 1, second - first - 1));
+			result.b = std::stod(text.substr(second + 1));
+			return result;
+		}
+
+		uint32_t sample(UnitRandom& random, uint32_t minimum) const
+		{
+			double value;
+			if (normal)
+			{
+				//Box-Muller.
+				const double u1 = 1.0 - random.real();
+				const double u2 = random.real();
+				value = a + b * std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+			}
+			else
+			{
+				value = a + std::floor(random.real() * (b - a + 1));
+			}
+			value = std::round(value);
+			return static_cast<uint32_t>(std::clamp(value, static_cast<double>(minimum), 4294967295.0));
+		}
+	};
+
+	struct Options
+	{
+		uint32_t width = 1000;
+		uint32_t height = 1000;
+		uint64_t warriors = 1000;
+		uint64_t archers = 1000;
+		std::string layout = "uniform";
+		std::string march = "random";
+		uint64_t seed = 1;
+		Distribution hp { false, 10, 100 };
+		Distribution strength { false, 1, 10 };
+		Distribution agility { false, 1, 10 };
+		Distribution range { false, 2, 8 };
+		bool binary = false;
+		std::string output;
+	};
+
+	//! \brief Rectangle units of a group are spread over.
+	struct Area
+	{
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+
+		uint64_t cells() const
+		{
+			return static_cast<uint64_t>(width) * height;
+		}
+	};
+
+	class Generator {
+	private:
+		static constexpr double maxDensity = 0.5;
+
+		const Options& _options;
+		uint64_t _units;
+		//! \brief Area of every group: one for uniform and blob layouts, one per army.
+		Area _areas[2];
+		uint32_t _groups = 1;
+		Permutation _cells[2];
+
+		Area blobArea(uint64_t units) const
+		{
+			const auto side = static_cast<uint64_t>(std::ceil(std::sqrt(units / maxDensity)));
+			Area area;
+			area.width = static_cast<uint32_t>(std::min<uint64_t>(std::max<uint64_t>(side, 1), _options.width));
+			area.height = static_cast<uint32_t>(std::min<uint64_t>(std::max<uint64_t>((units + area.width - 1) / area.width * 2, 1), _options.height));
+			area.x = (_options.width - area.width) / 2;
+			area.y = (_options.height - area.height) / 2;
+			return area;
+		}
+
+		void layOut()
+		{
+			const Area map { 0, 0, _options.width, _options.height };
+			if (_options.layout == "uniform")
+			{
+				_areas[0] = map;
+			}
+			else if (_options.layout == "blob")
+			{
+				_areas[0] = blobArea(_units);
+			}
+			else if (_options.layout == "armies")
+			{
+				//Two bands at the opposite edges, as deep as needed to hold half of the units each. They do not overlap.
+				if (_options.width < 2)
+					throw std::runtime_error("Armies need a map at least 2 cells wide");
+				_groups = 2;
+				const auto perSide = (_units + 1) / 2;
+				const auto depth = static_cast<uint64_t>(std::ceil(perSide / (maxDensity * _options.height)));
+				const auto band = static_cast<uint32_t>(std::min<uint64_t>(std::max<uint64_t>(depth, 1), _options.width / 2));
+				_areas[0] = { 0, 0, band, _options.height };
+				_areas[1] = { _options.width - band, 0, band, _options.height };
+			}
+			else
+			{
+				throw std::runtime_error("Unknown layout: " + _options.layout);
+			}
+			for (uint32_t group = 0; group < _groups; ++group)
+			{
+				const auto units = _units / _groups + (group < _units % _groups);
+				if (units > _areas[group].cells())
+					throw std::runtime_error("Too many units for the map");
+			}
+		}
+
+		bool archer(uint64_t unit) const
+		{
+			//Archers are spread evenly among warriors.
+			return (unit + 1) * _options.archers / _units > unit * _options.archers / _units;
+		}
+
+		uint32_t group(uint64_t unit) const
+		{
+			return static_cast<uint32_t>(unit % _groups);
+		}
+
+		void cell(uint64_t unit, uint32_t& x, uint32_t& y) const
+		{
+			const auto g = group(unit);
+			const auto& area = _areas[g];
+			const auto index = _cells[g](unit / _groups);
+			x = area.x + static_cast<uint32_t>(index % area.width);
+			y = area.y + static_cast<uint32_t>(index / area.width);
+		}
+
+		void target(uint64_t unit, uint32_t x, uint32_t y, uint32_t& targetX, uint32_t& targetY) const
+		{
+			if (_options.march == "random")
+			{
+				UnitRandom random(_options.seed, unit, 1);
+				targetX = static_cast<uint32_t>(random.below(_options.width));
+				targetY = static_cast<uint32_t>(random.below(_options.height));
+			}
+			else if (_options.march == "center")
+			{
+				targetX = _options.width / 2;
+				targetY = _options.height / 2;
+			}
+			else if (_options.march == "enemy")
+			{
+				//Across the map: armies swap their sides, other layouts go through the center.
+				targetX = _options.width - 1 - x;
+				targetY = _groups == 2 ? y : _options.height - 1 - y;
+			}
+			else if (_options.march == "stay")
+			{
+				targetX = x;
+				targetY = y;
+			}
+			else
+			{
+				throw std::runtime_error("Unknown march pattern: " + _options.march);
+			}
+		}
+
+		template <class TCommand>
+		static void print(std::string& out, TCommand command)
+		{
+			out.append(TCommand::Name);
+			io::CommandPrintVisitor visitor(out);
+			command.visit(visitor);
+			out.push_back('\n');
+		}
+
+		template <class TCommand>
+		void emit(std::string& out, TCommand command) const
+		{
+			if (_options.binary)
+				io::BinaryScenario::writeRecord(out, command);
+			else
+				print(out, command);
+		}
+
+	public:
+		explicit Generator(const Options& options) :
+			_options(options),
+			_units(options.warriors + options.archers),
+			_cells { Permutation(1, options.seed), Permutation(1, options.seed) }
+		{
+			if (!options.width || !options.height)
+				throw std::runtime_error("Incorrect width or height");
+			if (_units > UINT32_MAX)
+				throw std::runtime_error("Too many units");
+			layOut();
+			for (uint32_t g = 0; g < _groups; ++g)
+				_cells[g] = Permutation(_areas[g].cells(), options.seed + g);
+		}
+
+		void write(std::ostream& stream) const
+		{
+			constexpr size_t blockSize = 1 << 20;
+			std::string out;
+			out.reserve(blockSize + 256);
+			auto flush = [&](bool always)
+			{
+				if (always || out.size() >= blockSize)
+				{
+					stream.write(out.data(), static_cast<std::streamsize>(out.size()));
+					out.clear();
+				}
+			};
+
+			io::CreateMap map;
+			map.width = _options.width;
+			map.height = _options.height;
+			if (_options.binary)
+				io::BinaryScenario::writeHeader(out, map, static_cast<uint32_t>(_units), static_cast<uint32_t>(_units));
+			else
+				print(out, map);
+
+			for (uint64_t unit = 0; unit < _units; ++unit)
+			{
+				UnitRandom random(_options.seed, unit, 0);
+				uint32_t x;
+				uint32_t y;
+				cell(unit, x, y);
+				const auto id = static_cast<uint32_t>(unit + 1);
+				const auto hp = _options.hp.sample(random, 1);
+				const auto strength = _options.strength.sample(random, 1);
+				if (archer(unit))
+					emit(out, io::SpawnArcher { id, x, y, hp, _options.agility.sample(random, 1), strength, _options.range.sample(random, 0) });
+				else
+					emit(out, io::SpawnWarrior { id, x, y, hp, strength });
+				flush(false);
+			}
+			for (uint64_t unit = 0; unit < _units; ++unit)
+			{
+				uint32_t x;
+				uint32_t y;
+				cell(unit, x, y);
+				io::March march;
+				march.unitId = static_cast<uint32_t>(unit + 1);
+				target(unit, x, y, march.targetX, march.targetY);
+				emit(out, march);
+				flush(false);
+			}
+			flush(true);
+		}
+	};
+
+	int usage()
+	{
+		std::cerr << "Usage: sw_generate [--width=N] [--height=N] [--warriors=N] [--archers=N]" << std::endl
+				  << "                   [--layout=uniform|armies|blob] [--march=random|center|enemy|stay] [--seed=N]" << std::endl
+				  << "                   [--hp=DIST] [--strength=DIST] [--agility=DIST] [--range=DIST]" << std::endl
+				  << "                   [--binary] [--out=FILE]" << std::endl
+				  << "DIST is uniform:MIN:MAX or normal:MEAN:STDDEV." << std::endl;
+		return 2;
+	}
+}
+
+//Generate a command file, or a binary scenario with --binary.
+int main(int argc, char** argv)
+{
+	Options options;
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const auto equals = arg.find('=');
+			const auto name = arg.substr(0, equals);
+			const auto value = equals == std::string::npos ? std::string() : arg.substr(equals + 1);
+			if (name == "--width")
+				options.width = static_cast<uint32_t>(std::stoul(value));
+			else if (name == "--height")
+				options.height = static_cast<uint32_t>(std::stoul(value));
+			else if (name == "--warriors")
+				options.warriors = std::stoull(value);
+			else if (name == "--archers")
+				options.archers = std::stoull(value);
+			else if (name == "--layout")
+				options.layout = value;
+			else if (name == "--march")
+				options.march = value;
+			else if (name == "--seed")
+				options.seed = std::stoull(value);
+			else if (name == "--hp")
+				options.hp = Distribution::parse(value);
+			else if (name == "--strength")
+				options.strength = Distribution::parse(value);
+			else if (name == "--agility")
+				options.agility = Distribution::parse(value);
+			else if (name == "--range")
+				options.range = Distribution::parse(value);
+			else if (name == "--binary")
+				options.binary = true;
+			else if (name == "--out")
+				options.output = value;
+			else
+				return usage();
+		}
+
+		const Generator generator(options);
+		if (options.output.empty())
+		{
+			generator.write(std::cout);
+			return std::cout ? 0 : 1;
+		}
+		std::ofstream file(options.output, std::ios::binary | std::ios::trunc);
+		if (!file)
+			throw std::runtime_error("Cannot open " + options.output);
+		generator.write(file);
+		return file ? 0 : 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+}
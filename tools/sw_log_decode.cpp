@@ -0,0 +1,63 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <IO/System/BinaryEventCodec.hpp>
+
+//Convert a binary event log back into the text the simulation prints.
+int main(int argc, char** argv)
+{
+	using namespace sw;
+
+	if (argc != 2 && argc != 3)
+	{
+		std::cerr << "Usage: sw_log_decode <binary log> [text log]" << std::endl;
+		return 2;
+	}
+	std::ifstream input(argv[1], std::ios::binary);
+	if (!input)
+	{
+		std::cerr << "Error: File not found: " << argv[1] << std::endl;
+		return 1;
+	}
+	const std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	std::ofstream file;
+	if (argc == 3)
+	{
+		file.open(argv[2], std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cerr << "Error: Cannot open " << argv[2] << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& output = argc == 3 ? file : std::cout;
+
+	try
+	{
+		std::string_view data(content);
+		BinaryEventDecoder::header(data);
+		BinaryEventDecoder decoder;
+		EventRecord record;
+		std::string block;
+		while (decoder.decode(data, record))
+		{
+			formatRecord(block, record);
+			if (block.size() >= (1 << 16))
+			{
+				output.write(block.data(), static_cast<std::streamsize>(block.size()));
+				block.clear();
+			}
+		}
+		output.write(block.data(), static_cast<std::streamsize>(block.size()));
+	}
+	catch (const std::exception& e)
+	{
+		output.flush();
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <IO/System/BinaryScenario.hpp>
+#include <IO/System/CommandParser.hpp>
+#include <IO/System/MappedFile.hpp>
+
+namespace
+{
+	int usage()
+	{
+		std::cerr << "Usage: sw_scenario compile <command file> <binary scenario>" << std::endl
+				  << "       sw_scenario decompile <binary scenario> [command file]" << std::endl;
+		return 2;
+	}
+
+	template <class TCommand>
+	void print(std::string& out, TCommand command)
+	{
+		out.append(TCommand::Name);
+		sw::io::CommandPrintVisitor visitor(out);
+		command.visit(visitor);
+		out.push_back('\n');
+	}
+}
+
+//Compile a command file into a binary scenario and back.
+int main(int argc, char** argv)
+{
+	using namespace sw;
+
+	if (argc < 3)
+		return usage();
+	const std::string mode = argv[1];
+	if ((mode == "compile" && argc != 4) || (mode == "decompile" && argc != 3 && argc != 4)
+		|| (mode != "compile" && mode != "decompile"))
+		return usage();
+
+	const MappedFile input(argv[2]);
+	if (!input.isOpen())
+	{
+		std::cerr << "Error: File not found: " << argv[2] << std::endl;
+		return 1;
+	}
+
+	std::string result;
+	try
+	{
+		if (mode == "compile")
+		{
+			io::BinaryScenarioWriter writer;
+			io::CommandParser parser;
+			parser.add<io::CreateMap>([&writer](auto command) { writer.add(command); })
+				.add<io::SpawnWarrior>([&writer](auto command) { writer.add(command); })
+				.add<io::SpawnArcher>([&writer](auto command) { writer.add(command); })
+				.add<io::March>([&writer](auto command) { writer.add(command); });
+			parser.parse(input.text());
+			result = writer.finish();
+		}
+		else
+		{
+			io::BinaryScenario::read(input.text(), [&result](const auto& command) { print(result, command); });
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::ofstream file;
+	if (argc == 4)
+	{
+		file.open(argv[3], std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cerr << "Error: Cannot open " << argv[3] << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& output = argc == 4 ? file : std::cout;
+	output.write(result.data(), static_cast<std::streamsize>(result.size()));
+	return output ? 0 : 1;
+}